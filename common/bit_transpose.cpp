@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "bit_transpose.hpp"
+
+namespace {
+    // Pack color byte (at bit offset SHIFT) of four pixel codes into one word,
+    // the code of the first strip going into the least significant byte
+    template<int SHIFT> inline uint32_t gather_bytes(
+        uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3)
+    {
+        return ((c0 >> SHIFT) & 0xFF)
+            | (((c1 >> SHIFT) & 0xFF) << 8)
+            | (((c2 >> SHIFT) & 0xFF) << 16)
+            | (((c3 >> SHIFT) & 0xFF) << 24);
+    }
+
+    // Transpose one color byte of eight strips into eight bit slots, merging
+    // them into the slots at byte position IGROUP unless this is the first
+    // group, in which case the slots are simply written
+    template<int SHIFT, bool FIRST_GROUP> inline void transpose_color_byte(
+        uint32_t* bit_slots, const uint32_t* c, int igroup)
+    {
+        uint32_t x = gather_bytes<SHIFT>(c[0], c[1], c[2], c[3]);
+        uint32_t y = gather_bytes<SHIFT>(c[4], c[5], c[6], c[7]);
+        transpose_8x8(x, y);
+        // Row j now holds bit j of every strip, the first bit slot is the
+        // most significant bit (row 7)
+        if(FIRST_GROUP) {
+            bit_slots[0] = y >> 24;
+            bit_slots[1] = (y >> 16) & 0xFF;
+            bit_slots[2] = (y >> 8) & 0xFF;
+            bit_slots[3] = y & 0xFF;
+            bit_slots[4] = x >> 24;
+            bit_slots[5] = (x >> 16) & 0xFF;
+            bit_slots[6] = (x >> 8) & 0xFF;
+            bit_slots[7] = x & 0xFF;
+        } else {
+            int shift = 8*igroup;
+            bit_slots[0] |= (y >> 24) << shift;
+            bit_slots[1] |= ((y >> 16) & 0xFF) << shift;
+            bit_slots[2] |= ((y >> 8) & 0xFF) << shift;
+            bit_slots[3] |= (y & 0xFF) << shift;
+            bit_slots[4] |= (x >> 24) << shift;
+            bit_slots[5] |= ((x >> 16) & 0xFF) << shift;
+            bit_slots[6] |= ((x >> 8) & 0xFF) << shift;
+            bit_slots[7] |= (x & 0xFF) << shift;
+        }
+    }
+
+    template<bool FIRST_GROUP> void transpose_group(uint32_t* bit_slots,
+        const uint32_t* const* strips, int nstrip, int igroup, int iled0, int nled)
+    {
+        const uint32_t* group_strips[8];
+        int istrip0 = 8*igroup;
+        int ngroup_strip = std::min(nstrip - istrip0, 8);
+        for(int istrip=0; istrip<ngroup_strip; istrip++) {
+            group_strips[istrip] = strips[istrip0 + istrip] + iled0;
+        }
+        uint32_t c[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        for(int iled=0; iled<nled; iled++) {
+            for(int istrip=0; istrip<ngroup_strip; istrip++) {
+                c[istrip] = group_strips[istrip][iled];
+            }
+            transpose_color_byte<24, FIRST_GROUP>(bit_slots, c, igroup);
+            transpose_color_byte<16, FIRST_GROUP>(bit_slots + 8, c, igroup);
+            transpose_color_byte<8, FIRST_GROUP>(bit_slots + 16, c, igroup);
+            bit_slots += 24;
+        }
+    }
+}
+
+void grbz_to_bit_slots(uint32_t* bit_slots, const uint32_t* const* strips,
+    int nstrip, int iled0, int nled)
+{
+    transpose_group<true>(bit_slots, strips, nstrip, 0, iled0, nled);
+    for(int igroup=1; 8*igroup<nstrip; igroup++) {
+        transpose_group<false>(bit_slots, strips, nstrip, igroup, iled0, nled);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Transposition of WS2812 grbz pixel codes from several strips into the bit
+// slot layout consumed by the ws2812_parallel PIO program. For each pixel
+// there are 24 words, one per bit of the grbz code starting with its most
+// significant bit (G7, G6 ... B0), in which bit i holds the bit of strip i.
+//
+// The strips are processed in groups of eight, transposing each color byte
+// of the group as an 8x8 bit matrix with three butterfly stages, so the cost
+// is a few word operations per strip and pixel rather than one per bit.
+
+// Transpose the 8x8 bit matrix whose rows are the bytes of x (rows 0-3, least
+// significant byte first) and y (rows 4-7), so that on return bit i of row j
+// is bit j of row i on entry.
+inline void transpose_8x8(uint32_t& x, uint32_t& y)
+{
+    uint32_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA;  x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AA;  y = y ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC; x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCC; y = y ^ t ^ (t << 14);
+    t = (x ^ (y << 4)) & 0xF0F0F0F0;  x = x ^ t;  y = y ^ (t >> 4);
+}
+
+// Write the 24*nled bit slots for pixels iled0 to iled0+nled-1 of nstrip
+// strips (1 <= nstrip <= 32), strips[i] pointing to the grbz codes of strip i.
+void grbz_to_bit_slots(uint32_t* bit_slots, const uint32_t* const* strips,
+    int nstrip, int iled0, int nled);
@@ -1,19 +1,53 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <new>
 
 #include <pico/time.h>
 #include <hardware/pio.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
 #include <hardware/clocks.h>
 
 #include "../common/build_date.hpp"
 #include "../common/input_menu.hpp"
 
 #include "color_led.hpp"
+#include "bit_transpose.hpp"
 #include "ws2812.pio.h"
+#include "apa102.pio.h"
 
 namespace {
     static BuildDate build_date(__DATE__,__TIME__);
+
+    // Each core takes the DMA interrupts of the instances it activated on a
+    // line of its own, DMA_IRQ_0 on core 0 and DMA_IRQ_1 on core 1, shared
+    // between those instances. They register the channels they own (and the
+    // segment each drives) here so the handlers can find them.
+    static SerialPIO* dma_irq_owner[NUM_DMA_CHANNELS] = { };
+    static uint8_t dma_irq_segment[NUM_DMA_CHANNELS] = { };
+    static unsigned dma_irq_nuser[NUM_CORES] = { };
+
+    // Hardware alarms used to time the latch, with their SerialPIO instance
+    static SerialPIO* latch_alarm_owner[NUM_ALARMS] = { };
+}
+
+uint32_t levels_to_apa102(const uint16_t* grb)
+{
+    static constexpr uint32_t MAX_LEVEL = 255*256;
+    uint32_t max_level = std::max(std::max(grb[0], grb[1]), grb[2]);
+    if(max_level == 0) {
+        return 0xE0000000;
+    }
+    // Levels are taken up by 31/gb, in units of 1/65536 of an output level
+    uint32_t gb = (max_level * 31 + MAX_LEVEL - 1) / MAX_LEVEL;
+    uint32_t scale = (31 * 65536 + gb * 128) / (gb * 256);
+    uint32_t g = std::min((grb[0] * scale + 32768) >> 16, uint32_t(255));
+    uint32_t r = std::min((grb[1] * scale + 32768) >> 16, uint32_t(255));
+    uint32_t b = std::min((grb[2] * scale + 32768) >> 16, uint32_t(255));
+    return ((0xE0 | gb) << 24) | (b << 16) | (g << 8) | r;
 }
 
 void rgb_to_hsv(int ir, int ig, int ib, int& ih, int& is, int& iv)
@@ -334,6 +368,7 @@ SerialPIO::~SerialPIO()
     if(program_activated_) {
         deactivate_program();
     }   
+    free_ring();
 }
 
 void SerialPIO::set_pin(int pin)
@@ -342,47 +377,924 @@ void SerialPIO::set_pin(int pin)
     pin_ = pin;
 }
 
+void SerialPIO::set_nsegment(int nsegment)
+{
+    hard_assert(!program_activated_);
+    hard_assert(nsegment > 0 and nsegment <= MAX_SEGMENTS);
+    nsegment_ = nsegment;
+}
+
+void SerialPIO::set_chip(int chip)
+{
+    hard_assert(!program_activated_);
+    hard_assert(chip >= 0 and chip < NUM_CHIPS);
+    chip_ = chip;
+    baudrate_ = CHIP_PROFILES[chip].baudrate;
+    latch_us_ = CHIP_PROFILES[chip].latch_us;
+    if(CHIP_PROFILES[chip].clocked) {
+        dither_ = false;
+    }
+}
+
 void SerialPIO::set_baudrate(int baudrate)
 {
     hard_assert(!program_activated_);
     baudrate_ = baudrate;
 }   
 
+void SerialPIO::set_rgbw(bool rgbw)
+{
+    hard_assert(!program_activated_);
+    rgbw_ = rgbw;
+}
+
+void SerialPIO::set_dither(bool dither)
+{
+    hard_assert(!program_activated_);
+    dither_ = dither;
+}
+
+void SerialPIO::set_pio_latch(bool pio_latch)
+{
+    hard_assert(!program_activated_);
+    pio_latch_ = pio_latch;
+}
+
 void SerialPIO::activate_program()
 {
     // puts("Activating WS2812 program .....");
     hard_assert(!program_activated_);
-    bool success = pio_claim_free_sm_and_add_program_for_gpio_range(
-        &ws2812_program, &pio_, &sm_, &offset_, pin_, 1, true);
-    pio_sm_clear_fifos(pio_, sm_);
-    hard_assert(success);
-    ws2812_program_init(pio_, sm_, offset_, pin_, baudrate_, false);
+    const ChipProfile& chip = chip_profile();
+    hard_assert(!chip.clocked or !dither_);
+    dma_irq_index_ = get_core_num();
+    if(chip.clocked) {
+        program_ = apa102_program;
+    } else if(pio_latch_) {
+        program_ = ws2812_latched_program_with_timing(program_instructions_, chip.t1, chip.t2, chip.t3);
+    } else {
+        program_ = ws2812_program_with_timing(program_instructions_, chip.t1, chip.t2, chip.t3);
+    }
+    int npin = segment_npin();
+    for(int iseg=0; iseg<nsegment_; iseg++) {
+        OutputSegment& seg = segment_[iseg];
+        int seg_pin = pin_ + iseg*npin;
+        // A PIO holds only 32 instructions, three copies of the latched
+        // program, so a copy is shared by all the segments in a PIO
+        seg.owns_program = not claim_sm_with_program(iseg, seg_pin, npin);
+        if(seg.owns_program) {
+            bool success = pio_claim_free_sm_and_add_program_for_gpio_range(
+                &program_, &seg.pio, &seg.sm, &seg.offset, seg_pin, npin, true);
+            hard_assert(success);
+        }
+        pio_sm_clear_fifos(seg.pio, seg.sm);
+        if(chip.clocked) {
+            apa102_program_init(seg.pio, seg.sm, seg.offset, seg_pin, baudrate_);
+        } else if(pio_latch_) {
+            ws2812_latched_program_init_cycles(seg.pio, seg.sm, seg.offset, seg_pin, baudrate_, rgbw_,
+                chip.cycles_per_bit());
+        } else {
+            ws2812_program_init_cycles(seg.pio, seg.sm, seg.offset, seg_pin, baudrate_, rgbw_,
+                chip.cycles_per_bit());
+        }
+
+        seg.dma_chan = dma_claim_unused_channel(true);
+        seg.tx_nblock = 0;
+        seg.tx_iblock = 0;
+        dma_irq_owner[seg.dma_chan] = this;
+        dma_irq_segment[seg.dma_chan] = iseg;
+        dma_irqn_set_channel_enabled(dma_irq_index_, seg.dma_chan, true);
+    }
+    if(dma_irq_nuser[dma_irq_index_]++ == 0) {
+        irq_add_shared_handler(DMA_IRQ_0 + dma_irq_index_,
+            dma_irq_index_ == 0 ? &SerialPIO::dma_irq0_handler : &SerialPIO::dma_irq1_handler,
+            PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0 + dma_irq_index_, true);
+    }
+
+    // The DREQ and chaining (to itself, i.e. none) are set for each block as
+    // it is started, since they depend on the segment
+    dma_buffer_config_ = dma_channel_get_default_config(segment_[0].dma_chan);
+    channel_config_set_transfer_data_size(&dma_buffer_config_, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_buffer_config_, true);
+    channel_config_set_write_increment(&dma_buffer_config_, false);
+    dma_run_config_ = dma_buffer_config_;
+    channel_config_set_read_increment(&dma_run_config_, false);
+
+    latch_alarm_ = hardware_alarm_claim_unused(true);
+    latch_alarm_owner[latch_alarm_] = this;
+    hardware_alarm_set_callback(latch_alarm_, &SerialPIO::latch_alarm_handler);
+    word_time_us_ = (bits_per_pixel() * 1000000 + baudrate_ - 1) / baudrate_;
+    if(latch_in_pio()) {
+        // The state machine rounds the latch up to whole loops, and the last
+        // bit and the loop setup add a few cycles more
+        uint64_t pio_hz = uint64_t(baudrate_) * chip.cycles_per_bit();
+        pio_latch_cycles_ = uint32_t(uint64_t(latch_us_) * pio_hz / 1000000);
+        uint32_t nloop = (ws2812_latched_header(1, pio_latch_cycles_) & 0xFFFF) + 1;
+        uint64_t cycles = nloop * ws2812_latched_LATCH_LOOP_CYCLES + chip.t3 + 1;
+        pio_latch_us_ = uint32_t((cycles * 1000000 + pio_hz - 1) / pio_hz);
+    }
+
+    for(auto& buffer : frame_buffer_) {
+        buffer.assign(non_, 0);
+    }
+    front_buffer_ = 0;
+    front_buffer_sent_ = false;
+    frame_filter_.claim();
+    power_limiter_.set_profile(chip.clocked ? APA102_POWER : rgbw_ ? SK6812_RGBW_POWER : WS2812_POWER);
+
+    // The errors start spread over their range, so that pixels at the same
+    // level do not all step up in the same frame
+    dither_level_.assign(dither_ ? 3*non_ : 0, 0);
+    dither_error_.resize(dither_level_.size());
+    for(unsigned i=0; i<dither_error_.size(); i++) {
+        dither_error_[i] = uint8_t(i * 157);
+    }
+    dither_level_valid_ = false;
+
+    transmit_active_ = false;
+    frame_pending_ = false;
+    latch_pending_ = false;
+    tx_nsegment_active_ = 0;
+    cpu_words_pending_ = false;
     program_activated_ = true;
     // puts("..... WS2812 program activated");
 }
 
+bool SerialPIO::claim_sm_with_program(int iseg, uint seg_pin, uint npin)
+{
+    // Look for a free state machine in a PIO where an earlier segment loaded
+    // the program, and which can reach the pins of this one
+    for(int jseg=0; jseg<iseg; jseg++) {
+        const OutputSegment& owner = segment_[jseg];
+        uint gpio_base = pio_get_gpio_base(owner.pio);
+        if(!owner.owns_program or seg_pin < gpio_base or seg_pin + npin > gpio_base + 32) {
+            continue;
+        }
+        int sm = pio_claim_unused_sm(owner.pio, false);
+        if(sm >= 0) {
+            OutputSegment& seg = segment_[iseg];
+            seg.pio = owner.pio;
+            seg.sm = sm;
+            seg.offset = owner.offset;
+            return true;
+        }
+    }
+    return false;
+}
+
 void SerialPIO::deactivate_program()
 {
     // puts("Deactivating WS2812 program .....");
     hard_assert(program_activated_);
+    // The interrupts are taken on the core that activated the program
+    hard_assert(get_core_num() == dma_irq_index_);
     flush();
-    pio_remove_program_and_unclaim_sm(
-        &ws2812_program, pio_, sm_, offset_);
+
+    hardware_alarm_set_callback(latch_alarm_, nullptr);
+    latch_alarm_owner[latch_alarm_] = nullptr;
+    hardware_alarm_unclaim(latch_alarm_);
+    latch_alarm_ = -1;
+
+    // In reverse, so that the program is removed from each PIO after the
+    // other segments running it have let go of their state machines
+    for(int iseg=nsegment_-1; iseg>=0; iseg--) {
+        OutputSegment& seg = segment_[iseg];
+        dma_irqn_set_channel_enabled(dma_irq_index_, seg.dma_chan, false);
+        dma_irq_owner[seg.dma_chan] = nullptr;
+        dma_channel_unclaim(seg.dma_chan);
+        seg.dma_chan = -1;
+
+        if(seg.owns_program) {
+            pio_remove_program_and_unclaim_sm(
+                &program_, seg.pio, seg.sm, seg.offset);
+        } else {
+            pio_sm_unclaim(seg.pio, seg.sm);
+        }
+    }
+    if(--dma_irq_nuser[dma_irq_index_] == 0) {
+        irq_set_enabled(DMA_IRQ_0 + dma_irq_index_, false);
+        irq_remove_handler(DMA_IRQ_0 + dma_irq_index_,
+            dma_irq_index_ == 0 ? &SerialPIO::dma_irq0_handler : &SerialPIO::dma_irq1_handler);
+    }
+    frame_filter_.unclaim();
+    free_ring();
     program_activated_ = false;
     // puts("..... WS2812 program deactivated");
 }
 
+void SerialPIO::put_pixel_array_dma(const uint32_t* pixel_codes, unsigned npixel)
+{
+    dither_level_valid_ = false;
+    begin_transmit();
+    add_tx_block(pixel_codes, 0, npixel);
+    queue_transmit();
+}
+
+void SerialPIO::put_pixel_spans_dma(const PixelSpan* spans, unsigned nspan, bool post_process)
+{
+    hard_assert(nspan <= MAX_TX_BLOCKS);
+    dither_level_valid_ = false;
+    begin_transmit();
+    PowerLimiter::LevelSums sums = { };
+    for(unsigned ispan=0; ispan<nspan; ispan++) {
+        uint32_t pixel_code = spans[ispan].pixel_code;
+        if(post_process) {
+            pixel_code = post_processor_.apply(pixel_code);
+        }
+        if(rgbw_ and !clocked()) {
+            pixel_code = grbz_to_grbw(pixel_code);
+        }
+        sums.add(pixel_code, spans[ispan].npixel);
+        add_tx_block(nullptr, pixel_code, spans[ispan].npixel);
+    }
+    if(power_limiter_.enabled()) {
+        uint32_t factor = limit_power(sums);
+        if(factor != PowerLimiter::FACTOR_ONE) {
+            for(unsigned iblock=0; iblock<tx_nblock_; iblock++) {
+                tx_block_[iblock].fill_code = PowerLimiter::scale(tx_block_[iblock].fill_code, factor);
+            }
+        }
+    }
+    if(clocked()) {
+        for(unsigned iblock=0; iblock<tx_nblock_; iblock++) {
+            tx_block_[iblock].fill_code = grbz_to_apa102(tx_block_[iblock].fill_code);
+        }
+    }
+    queue_transmit();
+}
+
+void SerialPIO::send_frame()
+{
+    bool limit = power_limiter_.enabled();
+    PowerLimiter::LevelSums sums = { };
+
+    if(dither_) {
+        const std::vector<uint32_t>& frame = frame_buffer_[1-front_buffer_];
+        uint16_t* level = dither_level_.data();
+        for(unsigned i=0; i<frame.size(); i++, level+=3) {
+            post_processor_.expand(frame[i], level);
+            if(limit) {
+                sums.level[0] += level[0];
+                sums.level[1] += level[1];
+                sums.level[2] += level[2];
+            }
+        }
+        if(limit) {
+            // The sums are of levels with 8 more bits
+            for(auto& level_sum : sums.level) {
+                level_sum >>= 8;
+            }
+            uint32_t factor = limit_power(sums);
+            if(factor != PowerLimiter::FACTOR_ONE) {
+                for(uint16_t& level : dither_level_) {
+                    level = (level * factor) >> 16;
+                }
+            }
+        }
+        dither_level_valid_ = true;
+        send_dithered_frame();
+        return;
+    }
+
+    std::vector<uint32_t>& frame = frame_buffer_[1-front_buffer_];
+
+    // Correction, white extraction and power estimate in a single pass over
+    // the frame, only scaling it in a second pass if it is over the budget
+    if(clocked()) {
+        encode_clocked_frame(frame, limit);
+    } else if(limit) {
+        for(uint32_t& pixel_code : frame) {
+            uint32_t code = post_processor_.apply(pixel_code);
+            if(rgbw_) {
+                code = grbz_to_grbw(code);
+            }
+            sums.add(code);
+            pixel_code = code;
+        }
+        uint32_t factor = limit_power(sums);
+        if(factor != PowerLimiter::FACTOR_ONE) {
+            PowerLimiter::scale(frame.data(), frame.size(), factor);
+        }
+    } else if(rgbw_) {
+        for(uint32_t& pixel_code : frame) {
+            pixel_code = grbz_to_grbw(post_processor_.apply(pixel_code));
+        }
+    } else if(!post_processor_.identity()) {
+        post_processor_.apply(frame.data(), frame.size());
+    }
+
+    FrameFilter::Action action = frame_filter_.filter(frame.data(), frame.size(),
+        refresh_interval_, front_buffer_sent_ and !cpu_words_pending_);
+    if(action == FrameFilter::SKIP) {
+        return;
+    }
+    bool send_prefix = (action == FrameFilter::SEND_PREFIX);
+
+    begin_transmit();
+    unsigned npad = std::max(nled_ - int(frame.size()), 0);
+    unsigned offset = back_ ? npad : 0;
+
+    // Pixels to send on each segment, up to the last one that has changed
+    unsigned segment_npixel[MAX_SEGMENTS];
+    if(send_prefix) {
+        const std::vector<uint32_t>& last_frame = frame_buffer_[front_buffer_];
+        unsigned seg_nled = segment_nled();
+        for(int iseg=0; iseg<nsegment_; iseg++) {
+            unsigned ichain1 = (iseg == nsegment_-1) ? unsigned(nled_) : (iseg+1)*seg_nled;
+            segment_npixel[iseg] = changed_prefix(frame.data(), last_frame.data(), frame.size(),
+                iseg*seg_nled, ichain1, offset);
+        }
+    }
+
+    front_buffer_ = 1-front_buffer_;
+    if(back_) {
+        add_tx_block(nullptr, 0, npad);
+        add_tx_block(frame.data(), 0, frame.size());
+    } else {
+        add_tx_block(frame.data(), 0, frame.size());
+        add_tx_block(nullptr, 0, npad);
+    }
+    queue_transmit(send_prefix ? segment_npixel : nullptr);
+    front_buffer_sent_ = true;
+}
+
+void SerialPIO::send_dithered_frame()
+{
+    hard_assert(dither_level_valid_);
+    // The back buffer is free (the effect has finished with it) and is only
+    // written, so this can run while the front buffer is being transmitted
+    std::vector<uint32_t>& frame = frame_buffer_[1-front_buffer_];
+    PostProcessor::dither(frame.data(), dither_level_.data(), dither_error_.data(), frame.size());
+    if(rgbw_) {
+        for(uint32_t& pixel_code : frame) {
+            pixel_code = grbz_to_grbw(pixel_code);
+        }
+    }
+
+    begin_transmit();
+    front_buffer_ = 1-front_buffer_;
+    unsigned npad = std::max(nled_ - int(frame.size()), 0);
+    if(back_) {
+        add_tx_block(nullptr, 0, npad);
+        add_tx_block(frame.data(), 0, frame.size());
+    } else {
+        add_tx_block(frame.data(), 0, frame.size());
+        add_tx_block(nullptr, 0, npad);
+    }
+    queue_transmit();
+    ++dithered_frame_count_;
+}
+
+void SerialPIO::encode_clocked_frame(std::vector<uint32_t>& frame, bool limit)
+{
+    // The estimate is made on the corrected 8-bit codes, and the factor then
+    // applied to the levels with their 8 extra bits as they are encoded
+    uint32_t factor = PowerLimiter::FACTOR_ONE;
+    if(limit) {
+        PowerLimiter::LevelSums sums = { };
+        for(uint32_t pixel_code : frame) {
+            sums.add(post_processor_.apply(pixel_code));
+        }
+        factor = limit_power(sums);
+    }
+    uint16_t level[3];
+    for(uint32_t& pixel_code : frame) {
+        post_processor_.expand(pixel_code, level);
+        if(factor != PowerLimiter::FACTOR_ONE) {
+            level[0] = (level[0] * factor) >> 16;
+            level[1] = (level[1] * factor) >> 16;
+            level[2] = (level[2] * factor) >> 16;
+        }
+        pixel_code = levels_to_apa102(level);
+    }
+}
+
+std::vector<uint32_t>& SerialPIO::ring_buffer(unsigned nperiod)
+{
+    hard_assert(ring_period_supported(nperiod));
+    if(nperiod != ring_nperiod_) {
+        // The old buffers may still be being sent
+        wait_for_transmit();
+        free_ring();
+        size_t nbyte = 2 * nperiod * sizeof(uint32_t);
+        ring_wire_ = static_cast<uint32_t*>(::operator new[](nbyte, std::align_val_t(nbyte)));
+        std::fill(ring_wire_, ring_wire_ + 2*nperiod, 0);
+        ring_nperiod_ = nperiod;
+        ring_front_ = 0;
+        ring_committed_ = false;
+    }
+    ring_pattern_.resize(nperiod);
+    return ring_pattern_;
+}
+
+void SerialPIO::free_ring()
+{
+    if(ring_wire_) {
+        size_t nbyte = 2 * ring_nperiod_ * sizeof(uint32_t);
+        ::operator delete[](ring_wire_, std::align_val_t(nbyte));
+        ring_wire_ = nullptr;
+        ring_nperiod_ = 0;
+    }
+}
+
+void SerialPIO::commit_ring()
+{
+    // The back buffer of the pair is not being sent, so it can be written
+    // while the front one is
+    hard_assert(ring_wire_);
+    uint32_t* ring = ring_wire_ + (1-ring_front_) * ring_nperiod_;
+    PowerLimiter::LevelSums sums = { };
+    for(unsigned i=0; i<ring_nperiod_; i++) {
+        uint32_t code = post_processor_.apply(ring_pattern_[i]);
+        if(rgbw_ and !clocked()) {
+            code = grbz_to_grbw(code);
+        }
+        sums.add(code);
+        ring[i] = code;
+    }
+    uint32_t factor = PowerLimiter::FACTOR_ONE;
+    if(power_limiter_.enabled()) {
+        // The chain shows non_/ring_nperiod_ copies of the period
+        for(auto& level_sum : sums.level) {
+            level_sum = uint64_t(level_sum) * non_ / ring_nperiod_;
+        }
+        factor = limit_power(sums);
+    }
+    if(clocked()) {
+        uint16_t level[3];
+        for(unsigned i=0; i<ring_nperiod_; i++) {
+            post_processor_.expand(ring_pattern_[i], level);
+            if(factor != PowerLimiter::FACTOR_ONE) {
+                level[0] = (level[0] * factor) >> 16;
+                level[1] = (level[1] * factor) >> 16;
+                level[2] = (level[2] * factor) >> 16;
+            }
+            ring[i] = levels_to_apa102(level);
+        }
+    } else if(factor != PowerLimiter::FACTOR_ONE) {
+        PowerLimiter::scale(ring, ring_nperiod_, factor);
+    }
+    ring_committed_ = true;
+}
+
+void SerialPIO::send_ring_frame(unsigned start)
+{
+    hard_assert(ring_wire_);
+    dither_level_valid_ = false;
+    begin_transmit();
+    if(ring_committed_) {
+        ring_front_ = 1-ring_front_;
+        ring_committed_ = false;
+    }
+    const uint32_t* ring = ring_wire_ + ring_front_ * ring_nperiod_;
+    uint8_t ring_bits = __builtin_ctz(ring_nperiod_ * sizeof(uint32_t));
+    unsigned npad = std::max(nled_ - non_, 0);
+    if(back_) {
+        add_tx_block(nullptr, 0, npad);
+        add_tx_block(ring + (start & (ring_nperiod_-1)), 0, non_, ring_bits);
+    } else {
+        add_tx_block(ring + (start & (ring_nperiod_-1)), 0, non_, ring_bits);
+        add_tx_block(nullptr, 0, npad);
+    }
+    queue_transmit();
+}
+
+uint32_t SerialPIO::limit_power(const PowerLimiter::LevelSums& sums)
+{
+    // The padding is dark, but its LEDs still draw their idle current
+    uint32_t factor = power_limiter_.scale_factor(sums, nled_);
+    if(factor != PowerLimiter::FACTOR_ONE) {
+        ++limited_frame_count_;
+    }
+    current_ma_ = power_limiter_.current_ma(sums, nled_, factor);
+    return factor;
+}
+
+void SerialPIO::flush()
+{
+    hard_assert(program_activated_);
+    wait_for_latch();
+    if(cpu_words_pending_) {
+        PIO pio = segment_[0].pio;
+        uint32_t stall_mask = 1u << (PIO_FDEBUG_TXSTALL_LSB + segment_[0].sm);
+        pio->fdebug = stall_mask;
+        busy_wait_us(1);
+        while (!(pio->fdebug & stall_mask)) {
+            busy_wait_us(1);
+        }
+        busy_wait_us(latch_us_);
+        cpu_words_pending_ = false;
+    }
+}
+
+void SerialPIO::set_transmit_complete_callback(TransmitCompleteCallback callback,
+    void* callback_arg)
+{
+    wait_for_transmit();
+    transmit_complete_callback_ = callback;
+    transmit_complete_callback_arg_ = callback_arg;
+}
+
+void SerialPIO::begin_transmit()
+{
+    hard_assert(program_activated_);
+    wait_for_transmit();
+    if(cpu_words_pending_) {
+        flush();
+    }
+    tx_nblock_ = 0;
+    front_buffer_sent_ = false;
+}
+
+void SerialPIO::add_tx_block(const uint32_t* pixel_codes, uint32_t fill_code, unsigned npixel,
+    uint8_t ring_bits)
+{
+    if(npixel == 0) {
+        return;
+    }
+    hard_assert(tx_nblock_ < MAX_TX_BLOCKS);
+    tx_block_[tx_nblock_++] = { pixel_codes, fill_code, npixel, ring_bits };
+}
+
+void SerialPIO::split_tx_blocks()
+{
+    // Deal the blocks out to the segments, cutting them at the segment
+    // boundaries. Each segment gets at most one piece of each block, and the
+    // last segment takes anything beyond the end of the chain.
+    for(int iseg=0; iseg<nsegment_; iseg++) {
+        segment_[iseg].tx_nblock = 0;
+    }
+    unsigned seg_nled = segment_nled();
+    unsigned seg_room = seg_nled;
+    int iseg = 0;
+    for(unsigned iblock=0; iblock<tx_nblock_; iblock++) {
+        const TxBlock& block = tx_block_[iblock];
+        unsigned ipixel = 0;
+        while(ipixel < block.npixel) {
+            unsigned npixel = block.npixel - ipixel;
+            if(iseg < nsegment_-1) {
+                if(seg_room == 0) {
+                    ++iseg;
+                    seg_room = seg_nled;
+                    continue;
+                }
+                npixel = std::min(npixel, seg_room);
+                seg_room -= npixel;
+            }
+            OutputSegment& seg = segment_[iseg];
+            TxBlock& piece = seg.tx_block[seg.tx_nblock++];
+            piece = block;
+            piece.npixel = npixel;
+            if(piece.pixel_codes and piece.ring_bits) {
+                uintptr_t mask = (uintptr_t(1) << piece.ring_bits) - 1;
+                uintptr_t address = uintptr_t(block.pixel_codes);
+                piece.pixel_codes = reinterpret_cast<const uint32_t*>(
+                    (address & ~mask) | ((address + ipixel*sizeof(uint32_t)) & mask));
+            } else if(piece.pixel_codes) {
+                piece.pixel_codes += ipixel;
+            }
+            ipixel += npixel;
+        }
+    }
+}
+
+void SerialPIO::truncate_tx_blocks(OutputSegment& seg, unsigned npixel)
+{
+    unsigned nblock = 0;
+    while(nblock < seg.tx_nblock and npixel > 0) {
+        TxBlock& block = seg.tx_block[nblock++];
+        block.npixel = std::min(block.npixel, npixel);
+        npixel -= block.npixel;
+    }
+    seg.tx_nblock = nblock;
+}
+
+void SerialPIO::add_clocked_frames(OutputSegment& seg)
+{
+    // A segment with nothing to send is left alone, its LEDs keep their
+    // state. Otherwise the pixels follow a start frame of 32 zero bits, and
+    // are followed by a zero word (the SK9822 reset frame) and at least half
+    // a zero bit per LED, since each LED delays the data by half a clock.
+    if(seg.tx_nblock == 0) {
+        return;
+    }
+    std::copy_backward(seg.tx_block, seg.tx_block + seg.tx_nblock,
+        seg.tx_block + seg.tx_nblock + 1);
+    seg.tx_block[0] = { nullptr, 0, 1 };
+    seg.tx_block[seg.tx_nblock + 1] = { nullptr, 0, 1 + unsigned(segment_nled() + 63) / 64 };
+    seg.tx_nblock += 2;
+}
+
+void SerialPIO::add_latch_header(OutputSegment& seg)
+{
+    // As with clocked chips a segment with nothing to send is left alone
+    if(seg.tx_nblock == 0) {
+        return;
+    }
+    unsigned npixel = 0;
+    for(unsigned iblock=0; iblock<seg.tx_nblock; iblock++) {
+        npixel += seg.tx_block[iblock].npixel;
+    }
+    hard_assert(npixel * bits_per_pixel() <= 65536);
+    std::copy_backward(seg.tx_block, seg.tx_block + seg.tx_nblock,
+        seg.tx_block + seg.tx_nblock + 1);
+    seg.tx_block[0] = { nullptr, ws2812_latched_header(npixel * bits_per_pixel(), pio_latch_cycles_), 1 };
+    seg.tx_nblock += 1;
+}
+
+void SerialPIO::queue_transmit(const unsigned* segment_npixel)
+{
+    // The segment queues are free, since the previous transmission has
+    // completed, even if it is still being latched
+    split_tx_blocks();
+    if(segment_npixel) {
+        for(int iseg=0; iseg<nsegment_; iseg++) {
+            truncate_tx_blocks(segment_[iseg], segment_npixel[iseg]);
+        }
+    }
+    if(clocked()) {
+        for(int iseg=0; iseg<nsegment_; iseg++) {
+            add_clocked_frames(segment_[iseg]);
+        }
+    } else if(pio_latch_) {
+        for(int iseg=0; iseg<nsegment_; iseg++) {
+            add_latch_header(segment_[iseg]);
+        }
+    }
+    // The latch alarm may fire between the test and queueing the frame
+    uint32_t irq_status = save_and_disable_interrupts();
+    if(latch_pending_ and !latch_in_pio()) {
+        frame_pending_ = true;
+    } else {
+        start_transmit();
+    }
+    restore_interrupts(irq_status);
+}
+
+void SerialPIO::start_transmit()
+{
+    uint32_t dma_mask = 0;
+    int nactive = 0;
+    tx_start_us_ = time_us_32();
+    for(int iseg=0; iseg<nsegment_; iseg++) {
+        OutputSegment& seg = segment_[iseg];
+        seg.tx_iblock = 0;
+        if(seg.tx_nblock > 0) {
+            start_tx_block(seg, false);
+            dma_mask |= 1u << seg.dma_chan;
+            ++nactive;
+        }
+    }
+    if(nactive == 0) {
+        transmit_complete_irq(segment_[0]);
+        return;
+    }
+    transmit_active_ = true;
+    tx_nsegment_active_ = nactive;
+    dma_start_channel_mask(dma_mask);
+}
+
+void SerialPIO::start_tx_block(OutputSegment& seg, bool trigger)
+{
+    const TxBlock& block = seg.tx_block[seg.tx_iblock];
+    dma_channel_config c = block.pixel_codes ? dma_buffer_config_ : dma_run_config_;
+    channel_config_set_dreq(&c, pio_get_dreq(seg.pio, seg.sm, true));
+    channel_config_set_chain_to(&c, seg.dma_chan);
+    if(block.ring_bits) {
+        channel_config_set_ring(&c, false, block.ring_bits);
+    }
+    dma_channel_configure(seg.dma_chan, &c, &seg.pio->txf[seg.sm],
+        block.pixel_codes ? block.pixel_codes : &block.fill_code, block.npixel, trigger);
+}
+
+void SerialPIO::block_complete_irq(OutputSegment& seg)
+{
+    // The FIFO holds a few words, enough to cover the interrupt latency, so
+    // the next block follows without a gap the LEDs would see as a latch
+    if(++seg.tx_iblock < seg.tx_nblock) {
+        start_tx_block(seg, true);
+    } else if(--tx_nsegment_active_ == 0) {
+        transmit_complete_irq(seg);
+    }
+}
+
+void SerialPIO::transmit_complete_irq(const OutputSegment& seg)
+{
+    // The last words are still in the FIFO and OSR, so the line goes idle
+    // after they have been shifted out, the latch then starts. All segments
+    // run at the same rate, so the one finishing last is the last to drain.
+    uint32_t nword = pio_sm_get_tx_fifo_level(seg.pio, seg.sm) + 1;
+    uint32_t latch_end_us = nword * word_time_us_ + (latch_in_pio() ? pio_latch_us_ : latch_us_);
+    tx_end_us_ = time_us_32() + nword * word_time_us_;
+    transmit_active_ = false;
+    latch_pending_ = true;
+    if(latch_in_pio()) {
+        // The next frame may be started before this latch ends, so it is
+        // timed here, taking the latch the state machine is set to give
+        last_transmit_us_ = tx_end_us_ - tx_start_us_;
+        last_latch_us_ = pio_latch_us_;
+        ++timed_frame_count_;
+    }
+    if(hardware_alarm_set_target(latch_alarm_,
+            delayed_by_us(get_absolute_time(), latch_end_us))) {
+        latch_complete_irq();
+    }
+    if(transmit_complete_callback_) {
+        transmit_complete_callback_(this, transmit_complete_callback_arg_);
+    }
+}
+
+void SerialPIO::latch_complete_irq()
+{
+    if(!latch_in_pio()) {
+        last_transmit_us_ = tx_end_us_ - tx_start_us_;
+        last_latch_us_ = std::max(int32_t(time_us_32() - tx_end_us_), int32_t(0));
+        ++timed_frame_count_;
+    }
+    latch_pending_ = false;
+    if(frame_pending_) {
+        frame_pending_ = false;
+        start_transmit();
+    }
+}
+
+uint32_t SerialPIO::frame_timing(uint32_t& transmit_us, uint32_t& latch_us) const
+{
+    // Read again if the latch interrupt came in between
+    uint32_t count;
+    do {
+        count = timed_frame_count_;
+        transmit_us = last_transmit_us_;
+        latch_us = last_latch_us_;
+    } while(count != timed_frame_count_);
+    return count;
+}
+
+void SerialPIO::dma_irq0_handler()
+{
+    dma_irq_handler(0);
+}
+
+void SerialPIO::dma_irq1_handler()
+{
+    dma_irq_handler(1);
+}
+
+void SerialPIO::dma_irq_handler(uint irq_index)
+{
+    // Only the channels enabled on this line show a status on it
+    for(unsigned ichan=0; ichan<NUM_DMA_CHANNELS; ichan++) {
+        SerialPIO* owner = dma_irq_owner[ichan];
+        if(owner and dma_irqn_get_channel_status(irq_index, ichan)) {
+            dma_irqn_acknowledge_channel(irq_index, ichan);
+            owner->block_complete_irq(owner->segment_[dma_irq_segment[ichan]]);
+        }
+    }
+}
+
+void SerialPIO::latch_alarm_handler(uint alarm_num)
+{
+    SerialPIO* owner = latch_alarm_owner[alarm_num];
+    if(owner) {
+        owner->latch_complete_irq();
+    }
+}
+
+ParallelPIO::ParallelPIO(int pin_base, int nstrip, int baudrate):
+    pin_base_(pin_base), nstrip_(nstrip), baudrate_(baudrate)
+{
+    hard_assert(nstrip_ > 0 and nstrip_ <= MAX_STRIPS);
+}
+
+ParallelPIO::~ParallelPIO()
+{
+    if(program_activated_) {
+        deactivate_program();
+    }
+}
+
+void ParallelPIO::set_pin_base(int pin_base)
+{
+    hard_assert(!program_activated_);
+    pin_base_ = pin_base;
+}
+
+void ParallelPIO::set_nstrip(int nstrip)
+{
+    hard_assert(!program_activated_);
+    hard_assert(nstrip > 0 and nstrip <= MAX_STRIPS);
+    nstrip_ = nstrip;
+}
+
+void ParallelPIO::set_baudrate(int baudrate)
+{
+    hard_assert(!program_activated_);
+    baudrate_ = baudrate;
+}
+
+void ParallelPIO::set_nled(int nled)
+{
+    hard_assert(!program_activated_);
+    nled_ = nled;
+}
+
+void ParallelPIO::activate_program()
+{
+    hard_assert(!program_activated_);
+    bool success = pio_claim_free_sm_and_add_program_for_gpio_range(
+        &ws2812_parallel_program, &pio_, &sm_, &offset_, pin_base_, nstrip_, true);
+    hard_assert(success);
+    pio_sm_clear_fifos(pio_, sm_);
+    ws2812_parallel_program_init(pio_, sm_, offset_, pin_base_, nstrip_, baudrate_);
+
+    dma_chan_ = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan_);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio_, sm_, true));
+    dma_channel_configure(dma_chan_, &c, &pio_->txf[sm_], nullptr, 0, false);
+
+    strip_buffer_.resize(nstrip_);
+    for(auto& buffer : strip_buffer_) {
+        buffer.assign(nled_, 0);
+    }
+    for(auto& buffer : chunk_buffer_) {
+        buffer.resize(CHUNK_NLED * 24);
+    }
+    program_activated_ = true;
+}
+
+void ParallelPIO::deactivate_program()
+{
+    hard_assert(program_activated_);
+    flush();
+    dma_channel_unclaim(dma_chan_);
+    dma_chan_ = -1;
+    pio_remove_program_and_unclaim_sm(
+        &ws2812_parallel_program, pio_, sm_, offset_);
+    program_activated_ = false;
+}
+
+void ParallelPIO::transpose_chunk(uint32_t* bit_slots, int iled0, int nled) const
+{
+    const uint32_t* strips[MAX_STRIPS];
+    for(int istrip=0; istrip<nstrip_; istrip++) {
+        strips[istrip] = strip_buffer_[istrip].data();
+    }
+    grbz_to_bit_slots(bit_slots, strips, nstrip_, iled0, nled);
+}
+
+void ParallelPIO::send_frame()
+{
+    hard_assert(program_activated_);
+    flush();
+    int ibuffer = 0;
+    for(int iled=0; iled<nled_; iled+=CHUNK_NLED) {
+        int nled = std::min(CHUNK_NLED, nled_-iled);
+        uint32_t* bit_slots = chunk_buffer_[ibuffer].data();
+        transpose_chunk(bit_slots, iled, nled);
+        dma_channel_wait_for_finish_blocking(dma_chan_);
+        dma_channel_transfer_from_buffer_now(dma_chan_, bit_slots, nled * 24);
+        ibuffer = 1-ibuffer;
+        if(iled + nled == nled_) {
+            // The previous chunk is out of the DMA, so at most a full FIFO and
+            // the OSR are ahead of this one, each word taking one bit time
+            uint64_t nword = nled * 24 + 9;
+            latch_end_ = make_timeout_time_us((nword * 1000000 + baudrate_ - 1) / baudrate_ + latch_us_);
+        }
+    }
+}
+
+void ParallelPIO::flush() const
+{
+    hard_assert(program_activated_);
+    dma_channel_wait_for_finish_blocking(dma_chan_);
+    sleep_until(latch_end_);
+}
+
 SerialPIOMenu::SerialPIOMenu(int pin, int baudrate):
     SerialPIO(pin, baudrate), 
     SimpleItemValueMenu(make_menu_items())
 {
     timer_interval_us_ = 50000; // 20Hz
     set_pin_value(false);
+    set_nsegment_value(false);
+    set_chip_value(false);
     set_baudrate_value(false);
     set_nled_value(false);
     set_non_value(false);
     set_back_value(false);
+    set_latch_value(false);
+    set_pio_latch_value(false);
+    set_refresh_value(false);
+    set_rgbw_value(false);
+    set_gamma_value(false);
+    set_brightness_value(false);
+    set_dither_value(false);
+    set_power_value(false);
     set_lamp_test_value(false);
+    set_measured_value(false);
 }
 
 std::vector<int32_t> SerialPIOMenu::get_saved_state()
@@ -393,12 +1305,40 @@ std::vector<int32_t> SerialPIOMenu::get_saved_state()
     state.push_back(nled_);
     state.push_back(non_);
     state.push_back(back_ ? 1 : 0);
+    state.push_back(latch_us_);
+    state.push_back(rgbw_ ? 1 : 0);
+    state.push_back(nsegment_);
+    state.push_back(refresh_interval_);
+    state.push_back(post_processor_.gamma() ? 1 : 0);
+    state.push_back(post_processor_.brightness());
+    state.push_back(dither_ ? 1 : 0);
+    state.push_back(power_limiter_.budget_ma());
+    state.push_back(chip_);
+    state.push_back(pio_latch_ ? 1 : 0);
     return state;
 }
 
 bool SerialPIOMenu::set_saved_state(const std::vector<int32_t>& state)
 {
-    if(state.size() != 5) {
+    return set_saved_state_prefix(state, get_version());
+}
+
+bool SerialPIOMenu::set_old_saved_state(int32_t version, const std::vector<int32_t>& state)
+{
+    // Every version appended its new fields to the state of the one before
+    return version >= 0 and set_saved_state_prefix(state, version);
+}
+
+bool SerialPIOMenu::set_saved_state_prefix(const std::vector<int32_t>& state, int32_t version)
+{
+    // Number of entries saved by each version, fields missing from older
+    // versions keep their current (default) values
+    static constexpr unsigned STATE_SIZE[] = { 5, 6, 7, 8, 9, 11, 12, 13, 14, 15 };
+    const unsigned n = state.size();
+    if(version >= int32_t(sizeof(STATE_SIZE)/sizeof(STATE_SIZE[0]))
+            or n != STATE_SIZE[version]
+            or (n > 7 and (state[7] < 1 or state[7] > MAX_SEGMENTS))
+            or (n > 13 and (state[13] < 0 or state[13] >= NUM_CHIPS))) {
         return false;
     }
     pin_ = state[0];
@@ -406,17 +1346,40 @@ bool SerialPIOMenu::set_saved_state(const std::vector<int32_t>& state)
     nled_ = state[2];
     non_ = state[3];
     back_ = (state[4] != 0);
+    if(n > 5) latch_us_ = state[5];
+    if(n > 6) rgbw_ = (state[6] != 0);
+    if(n > 7) nsegment_ = state[7];
+    if(n > 8) refresh_interval_ = state[8];
+    if(n > 9) post_processor_.set_gamma(state[9] != 0);
+    if(n > 10) post_processor_.set_brightness(std::min(std::max(int(state[10]), 0), PostProcessor::MAX_BRIGHTNESS));
+    if(n > 11) dither_ = (state[11] != 0);
+    if(n > 12) power_limiter_.set_budget_ma(std::max(int(state[12]), 0));
+    if(n > 13) chip_ = state[13];
+    if(n > 14) pio_latch_ = (state[14] != 0);
+    if(clocked()) {
+        dither_ = false;
+    }
     set_pin_value(false);
+    set_nsegment_value(false);
+    set_chip_value(false);
     set_baudrate_value(false);
     set_nled_value(false);
     set_non_value(false);
     set_back_value(false);
+    set_latch_value(false);
+    set_pio_latch_value(false);
+    set_refresh_value(false);
+    set_rgbw_value(false);
+    set_gamma_value(false);
+    set_brightness_value(false);
+    set_dither_value(false);
+    set_power_value(false);
     return true;
 }
 
 int32_t SerialPIOMenu::get_version()
 {
-    return 0;
+    return 9;
 }
     
 int32_t SerialPIOMenu::get_supplier_id()
@@ -435,6 +1398,20 @@ void SerialPIOMenu::set_pin_value(bool draw)
     if(draw)draw_item_value(MIP_PIN);
 }
 
+void SerialPIOMenu::set_nsegment_value(bool draw)
+{
+    menu_items_[MIP_NSEGMENT].value = std::to_string(nsegment_);
+    if(draw)draw_item_value(MIP_NSEGMENT);
+    set_frame_rate_value(draw);
+}
+
+void SerialPIOMenu::set_chip_value(bool draw)
+{
+    menu_items_[MIP_CHIP].value = chip_profile().name;
+    if(draw)draw_item_value(MIP_CHIP);
+    set_frame_rate_value(draw);
+}
+
 void SerialPIOMenu::set_baudrate_value(bool draw)
 {
     menu_items_[MIP_BAUDRATE].value = std::to_string(baudrate_);
@@ -463,16 +1440,135 @@ void SerialPIOMenu::set_back_value(bool draw)
     set_frame_rate_value(draw);
 }
 
+void SerialPIOMenu::set_latch_value(bool draw)
+{
+    menu_items_[MIP_LATCH].value = std::to_string(latch_us_);
+    if(draw)draw_item_value(MIP_LATCH);
+    set_frame_rate_value(draw);
+}
+
+void SerialPIOMenu::set_pio_latch_value(bool draw)
+{
+    menu_items_[MIP_PIO_LATCH].set_onoff(pio_latch_);
+    if(draw)draw_item_value(MIP_PIO_LATCH);
+}
+
+void SerialPIOMenu::set_refresh_value(bool draw)
+{
+    menu_items_[MIP_REFRESH].value = std::to_string(refresh_interval_);
+    if(draw)draw_item_value(MIP_REFRESH);
+    set_frame_rate_value(draw);
+}
+
+void SerialPIOMenu::set_rgbw_value(bool draw)
+{
+    menu_items_[MIP_RGBW].value = rgbw_ ? "RGBW" : "RGB";
+    if(draw)draw_item_value(MIP_RGBW);
+    set_frame_rate_value(draw);
+}
+
+void SerialPIOMenu::set_gamma_value(bool draw)
+{
+    menu_items_[MIP_GAMMA].set_onoff(post_processor_.gamma());
+    if(draw)draw_item_value(MIP_GAMMA);
+}
+
+void SerialPIOMenu::set_brightness_value(bool draw)
+{
+    menu_items_[MIP_BRIGHTNESS].value = std::to_string(post_processor_.brightness());
+    if(draw)draw_item_value(MIP_BRIGHTNESS);
+}
+
+void SerialPIOMenu::set_dither_value(bool draw)
+{
+    menu_items_[MIP_DITHER].set_onoff(dither_);
+    if(draw)draw_item_value(MIP_DITHER);
+}
+
+void SerialPIOMenu::set_power_value(bool draw)
+{
+    menu_items_[MIP_POWER].value = std::to_string(power_limiter_.budget_ma());
+    if(draw)draw_item_value(MIP_POWER);
+}
+
 void SerialPIOMenu::set_frame_rate_value(bool draw)
 {
-    unsigned npix = back_ ? nled_ : non_;
-    float frame_rate = baudrate_ / (float)(npix * 24);
+    // All segments are sent together, so the longest one (the first) sets
+    // the frame time. Full frames carry the whole segment, padding included.
+    // With a refresh interval the frames in between stop after the last
+    // changed pixel, so in front mode they carry at most the LEDs that are on.
+    unsigned seg_nled = segment_nled();
+    unsigned npix_full = seg_nled;
+    unsigned npix_prefix = back_ ? seg_nled : std::min(unsigned(non_), seg_nled);
+    // Clocked chips add a start frame and the end frames to each segment
+    unsigned nbit_extra = clocked() ? 32 * (2 + (seg_nled + 63) / 64) : 0;
+    auto frame_time = [this,nbit_extra](unsigned npix) {
+        return (npix * bits_per_pixel() + nbit_extra) * 1e6f / baudrate_ + latch_us_;
+    };
+    float frame_time_us = frame_time(npix_full);
+    if(refresh_interval_ > 0) {
+        frame_time_us = (frame_time_us + (refresh_interval_ - 1) * frame_time(npix_prefix))
+            / refresh_interval_;
+    }
+    float frame_rate = 1e6f / frame_time_us;
     char buf[16];
     std::snprintf(buf, sizeof(buf), "%.1f", frame_rate);
     menu_items_[MIP_FRAME_RATE].value = std::string(buf);
     if(draw)draw_item_value(MIP_FRAME_RATE);
 }
 
+void SerialPIOMenu::set_measured_value(bool draw)
+{
+    const FrameStats& stats = measured_stats_;
+    const TimeStats* times = nullptr;
+    const char* times_name = "";
+    char buf[48];
+    switch(stats.nframe == 0 ? -1 : measured_view_) {
+    case -1:
+        std::snprintf(buf, sizeof(buf), "-");
+        break;
+    case MV_RATE:
+        std::snprintf(buf, sizeof(buf), "%.1f Hz %d%% %d%%",
+            stats.frame_rate_mhz() * 1e-3f,
+            (stats.core0_load_permille() + 5) / 10,
+            (stats.core1_load_permille() + 5) / 10);
+        break;
+    case MV_COUNTS:
+        std::snprintf(buf, sizeof(buf), "miss %lu skip %lu dith %lu",
+            (unsigned long)stats.nmissed, (unsigned long)stats.nskipped,
+            (unsigned long)stats.ndithered);
+        break;
+    case MV_CURRENT:
+        std::snprintf(buf, sizeof(buf), "%lu/%lu mA lim %lu",
+            (unsigned long)stats.mean_current_ma(), (unsigned long)stats.current_ma_max,
+            (unsigned long)stats.nlimited);
+        break;
+    case MV_RENDER:
+        times = &stats.render;
+        times_name = "render";
+        break;
+    case MV_TRANSMIT:
+        times = &stats.transmit;
+        times_name = "xmit";
+        break;
+    case MV_LATCH:
+        times = &stats.latch;
+        times_name = "latch";
+        break;
+    case MV_IDLE:
+        times = &stats.idle;
+        times_name = "idle";
+        break;
+    }
+    if(times) {
+        std::snprintf(buf, sizeof(buf), "%s %lu/%lu/%lu us", times_name,
+            (unsigned long)times->min_us, (unsigned long)times->mean_us(),
+            (unsigned long)times->max_us);
+    }
+    menu_items_[MIP_MEASURED].value = std::string(buf);
+    if(draw)draw_item_value(MIP_MEASURED);
+}
+
 void SerialPIOMenu::set_lamp_test_value(bool draw)
 {
     menu_items_[MIP_LAMP_TEST].set_onoff(lamp_test_cycle_>=0);
@@ -482,13 +1578,24 @@ void SerialPIOMenu::set_lamp_test_value(bool draw)
 std::vector<SerialPIOMenu::MenuItem> SerialPIOMenu::make_menu_items()
 {
     std::vector<MenuItem> menu_items(MIP_NUM_ITEMS);
-    menu_items.at(MIP_PIN)         = {"P       : Set GPIO pin", 2, "0"};
+    menu_items.at(MIP_PIN)         = {"P       : Set GPIO pin (clock pin for APA102)", 2, "0"};
+    menu_items.at(MIP_NSEGMENT)    = {"K       : Set number of segments (consecutive pins)", 1, "1"};
+    menu_items.at(MIP_CHIP)        = {"C       : Cycle LED chip timing profile", 11, "WS2812"};
     menu_items.at(MIP_BAUDRATE)    = {"B       : Set baud rate [bits/sec]", 8, "0"};
     menu_items.at(MIP_NLED)        = {"-/N/+   : Decrease/Set/Increase number of LEDs", 4, "0"};
     menu_items.at(MIP_NON)         = {"</n/>   : Decrease/Set/Increase number of active LEDs", 4, "0"};
     menu_items.at(MIP_BACK)        = {"f       : Set front/back", 5, "FRONT"};
+    menu_items.at(MIP_LATCH)       = {"T       : Set latch (reset) time [us]", 4, "300"};
+    menu_items.at(MIP_PIO_LATCH)   = {"H       : Latch generated by PIO (frames back to back)", 4, "OFF"};
+    menu_items.at(MIP_REFRESH)     = {"R       : Set full refresh interval [frames, 0=all]", 4, "50"};
+    menu_items.at(MIP_RGBW)        = {"W       : Set RGB/RGBW (SK6812) pixels", 4, "RGB"};
+    menu_items.at(MIP_GAMMA)       = {"G       : Gamma correction", 4, "OFF"};
+    menu_items.at(MIP_BRIGHTNESS)  = {"I       : Set brightness [0-255]", 3, "255"};
+    menu_items.at(MIP_DITHER)      = {"D       : Temporal dithering at full frame rate", 4, "OFF"};
+    menu_items.at(MIP_POWER)       = {"A       : Set power budget [mA, 0=unlimited]", 5, "0"};
     menu_items.at(MIP_LAMP_TEST)   = {"l       : Lamp test", 4, "OFF"};
     menu_items.at(MIP_FRAME_RATE)  = {"        : Maximum frame refresh rate [Hz]", 8, "0"};
+    menu_items.at(MIP_MEASURED)    = {"S       : Cycle measured rate & load, counts, current, times", 26, "-"};
     menu_items.at(MIP_EXIT)        = {"q       : Quit", 0, ""};
     return menu_items;
 }
@@ -497,22 +1604,25 @@ void SerialPIOMenu::send_color_string()
 {
     // puts("Sending color string .....");
     if(lamp_test_cycle_ < 0 or non_ == 0) {
-        put_pixel(0, nled_);
+        put_pixel_run_dma(0, nled_);
     } else {
+        // The lamp test levels are sent without correction, which would
+        // otherwise make the dim ones invisible
         uint32_t color_code = rgb_to_grbz(0, 7, 0) >> (lamp_test_cycle_*8);
         if(back_) {
-            put_pixel(0, nled_-non_);
-            put_pixel(color_code, non_ - lamp_test_count_ - 1);
-            put_pixel(color_code<<4, 1);
-            put_pixel(color_code, lamp_test_count_);
+            put_pixel_spans_dma({
+                { 0, unsigned(nled_-non_) },
+                { color_code, unsigned(non_ - lamp_test_count_ - 1) },
+                { color_code<<4, 1 },
+                { color_code, unsigned(lamp_test_count_) } }, false);
         } else {
-            put_pixel(color_code, lamp_test_count_);
-            put_pixel(color_code<<4, 1);
-            put_pixel(color_code, non_ - lamp_test_count_ - 1);
-            put_pixel(0, nled_-non_);
+            put_pixel_spans_dma({
+                { color_code, unsigned(lamp_test_count_) },
+                { color_code<<4, 1 },
+                { color_code, unsigned(non_ - lamp_test_count_ - 1) },
+                { 0, unsigned(nled_-non_) } }, false);
         }
     }
-    flush();
     // puts("..... color string sent");
 }
 
@@ -557,17 +1667,45 @@ bool SerialPIOMenu::process_key_press(int key, int key_count, int& return_code,
                 beep();
             }
         } else {
-            InplaceInputMenu::input_value_in_range(pin_, 0, 28, this, MIP_PIN, 2);
+            InplaceInputMenu::input_value_in_range(pin_, 0, 29-nsegment_*segment_npin(), this, MIP_PIN, 2);
             set_pin_value();
         }
         break;
+    case 'K':
+        if(lamp_test_cycle_ >= 0) {
+            if(key_count==1) {
+                beep();
+            }
+        } else {
+            InplaceInputMenu::input_value_in_range(nsegment_, 1,
+                std::min(MAX_SEGMENTS, (29-pin_)/segment_npin()), this, MIP_NSEGMENT, 1);
+            set_nsegment_value();
+        }
+        break;
+    case 'C':
+        if(lamp_test_cycle_ >= 0) {
+            if(key_count==1) {
+                beep();
+            }
+        } else {
+            set_chip((chip_ + 1) % NUM_CHIPS);
+            if(pin_ + nsegment_*segment_npin() > 29) {
+                pin_ = 29 - nsegment_*segment_npin();
+                set_pin_value();
+            }
+            set_chip_value();
+            set_baudrate_value();
+            set_latch_value();
+            set_dither_value();
+        }
+        break;
     case 'B':
         if(lamp_test_cycle_ >= 0) {
             if(key_count==1) {
                 beep();
             }
         } else {
-            InplaceInputMenu::input_value_in_range(baudrate_, 0, 10000000, this, MIP_BAUDRATE, 8);
+            InplaceInputMenu::input_value_in_range(baudrate_, 0, 30000000, this, MIP_BAUDRATE, 8);
             set_baudrate_value();
         }
         break;
@@ -640,6 +1778,92 @@ bool SerialPIOMenu::process_key_press(int key, int key_count, int& return_code,
         }
         break;
 
+    case 'T':
+        if(lamp_test_cycle_ >= 0) {
+            if(key_count==1) {
+                beep();
+            }
+        } else {
+            InplaceInputMenu::input_value_in_range(latch_us_, 0, 5000, this, MIP_LATCH, 4);
+            set_latch_value();
+        }
+        break;
+
+    case 'H':
+        if(lamp_test_cycle_ >= 0 or clocked()) {
+            if(key_count==1) {
+                beep();
+            }
+        } else {
+            pio_latch_ = !pio_latch_;
+            set_pio_latch_value();
+        }
+        break;
+
+    case 'R':
+        InplaceInputMenu::input_value_in_range(refresh_interval_, 0, 1000, this, MIP_REFRESH, 4);
+        set_refresh_value();
+        break;
+
+    case 'W':
+        if(lamp_test_cycle_ >= 0 or clocked()) {
+            if(key_count==1) {
+                beep();
+            }
+        } else {
+            rgbw_ = !rgbw_;
+            set_rgbw_value();
+        }
+        break;
+
+    case 'G':
+        post_processor_.set_gamma(!post_processor_.gamma());
+        set_gamma_value();
+        break;
+
+    case 'I':
+        {
+            int brightness = post_processor_.brightness();
+            InplaceInputMenu::input_value_in_range(brightness, 0, PostProcessor::MAX_BRIGHTNESS,
+                this, MIP_BRIGHTNESS, 3);
+            post_processor_.set_brightness(brightness);
+            set_brightness_value();
+        }
+        break;
+
+    case 'D':
+        if(lamp_test_cycle_ >= 0 or clocked()) {
+            if(key_count==1) {
+                beep();
+            }
+        } else {
+            dither_ = !dither_;
+            set_dither_value();
+        }
+        break;
+
+    case 'A':
+        {
+            int budget_ma = power_limiter_.budget_ma();
+            InplaceInputMenu::input_value_in_range(budget_ma, 0, 99999, this, MIP_POWER, 5);
+            power_limiter_.set_budget_ma(budget_ma);
+            set_power_value();
+        }
+        break;
+
+    case 'S':
+        // Move on to the next view of the last window sent by the output
+        // engine, which is redrawn with each window
+        if(measured_stats_.nframe == 0) {
+            if(key_count==1) {
+                beep();
+            }
+        } else {
+            measured_view_ = (measured_view_ + 1) % NUM_MEASURED_VIEWS;
+            set_measured_value();
+        }
+        break;
+
     case 'L':
     case 'l':
         if(lamp_test_cycle_ < 0) {
@@ -679,6 +1903,10 @@ bool SerialPIOMenu::process_timer(bool controller_is_connected, int& return_code
         heartbeat_timer_count_ = 0;
     }
 
+    if(frame_stats(measured_stats_, measured_stats_seq_)) {
+        set_measured_value();
+    }
+
     if(lamp_test_cycle_ >= 0) {
         lamp_test_count_ += 1;
         if(lamp_test_count_ >= non_) {
@@ -1,20 +1,31 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
+#include <initializer_list>
 #include "pico/time.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
 
 #include "menu.hpp"
 #include "saved_state.hpp"
+#include "lockfree.hpp"
+#include "frame_stats.hpp"
+#include "frame_hash.hpp"
+#include "post_process.hpp"
+#include "power_limit.hpp"
+#include "led_chip.hpp"
+#include "pixel_code.hpp"
 
-inline uint32_t rgb_to_grbz(uint32_t r, uint32_t g, uint32_t b) {
-    return ((r&0xFF) << 16) | ((g&0xFF) << 24) | ((b&0xFF) << 8);
-}
-
-inline void grbz_to_rgb(uint32_t grbz, uint32_t &r, uint32_t &g, uint32_t &b) {
-    b = (grbz>>8) & 0xFF;
-    r = (grbz>>16) & 0xFF;
-    g = (grbz>>24) & 0xFF;
+// APA102/SK9822 LED frame (0b111, 5-bit global brightness, blue, green, red)
+// for green, red and blue levels from 0 to 255*256. The global brightness is
+// the smallest that fits the brightest channel, and the channels are scaled
+// up to match, so dim pixels keep some of the 8 extra bits of their levels.
+uint32_t levels_to_apa102(const uint16_t* grb);
+inline uint32_t grbz_to_apa102(uint32_t grbz) {
+    uint16_t grb[3] = { uint16_t((grbz >> 24) << 8), uint16_t(((grbz >> 16) & 0xFF) << 8),
+        uint16_t(grbz & 0xFF00) };
+    return levels_to_apa102(grb);
 }
 
 void rgb_to_hsv(int r, int g, int b, int& h, int& s, int& v);
@@ -70,53 +81,244 @@ private:
 
 class SerialPIO {
 public:
+    typedef void (*TransmitCompleteCallback)(SerialPIO* serial_pio, void* arg);
+
+    // Run of npixel pixels with the same code
+    struct PixelSpan {
+        uint32_t pixel_code;
+        unsigned npixel;
+    };
+
+    // Maximum number of spans (or buffers) making up one transmission
+    static constexpr int MAX_TX_BLOCKS = 8;
+
+    // Maximum number of segments the chain can be split into, each driven
+    // from its own pin by its own state machine and DMA channel
+    static constexpr int MAX_SEGMENTS = 8;
+
+    // Longest period of a pattern that can be sent from a ring buffer
+    static constexpr unsigned MAX_RING_PIXELS = 1024;
+
     SerialPIO(int pin, int baudrate = 800000);
     ~SerialPIO();
 
     int pin() const { return pin_; }
+    int nsegment() const { return nsegment_; }
+    int chip() const { return chip_; }
+    const ChipProfile& chip_profile() const { return CHIP_PROFILES[chip_]; }
+    bool clocked() const { return CHIP_PROFILES[chip_].clocked; }
+    // GPIO pins used by each segment : data only, or clock and data
+    int segment_npin() const { return clocked() ? 2 : 1; }
     int baudrate() const { return baudrate_; }
     int nled() const { return nled_; }
     int non() const { return non_; }
     bool back() const { return back_; }
+    int latch_us() const { return latch_us_; }
+    bool rgbw() const { return rgbw_; }
+    int refresh_interval() const { return refresh_interval_; }
+    bool dither() const { return dither_; }
+    bool pio_latch() const { return pio_latch_; }
+    // The latch is generated by the state machines (not for clocked chips)
+    bool latch_in_pio() const { return pio_latch_ and !clocked(); }
+    const PostProcessor& post_processor() const { return post_processor_; }
+    PostProcessor& post_processor() { return post_processor_; }
+    const PowerLimiter& power_limiter() const { return power_limiter_; }
+    PowerLimiter& power_limiter() { return power_limiter_; }
+    int bits_per_pixel() const { return (rgbw_ or clocked()) ? 32 : 24; }
+    int segment_nled() const { return (nled_ + nsegment_ - 1) / nsegment_; }
 
     void set_pin(int pin);
+    void set_nsegment(int nsegment);
+    // Select the chip timing profile, which also sets the baud rate and latch
+    // time to the profile values. Clocked chips do not support dithering,
+    // which is turned off.
+    void set_chip(int chip);
     void set_baudrate(int baudrate);
     void set_nled(int nled) { nled_ = nled; }
     void set_non(int non) { non_ = non; }
     void set_back(bool back) { back_ = back; }
+    void set_latch_us(int latch_us) { latch_us_ = latch_us; }
+    void set_rgbw(bool rgbw);
+    void set_refresh_interval(int refresh_interval) { refresh_interval_ = refresh_interval; }
+    void set_dither(bool dither);
+    void set_pio_latch(bool pio_latch);
 
-    PIO pio() const { return pio_; }
-    uint sm() const { return sm_; }
+    PIO pio(int isegment = 0) const { return segment_[isegment].pio; }
+    uint sm(int isegment = 0) const { return segment_[isegment].sm; }
+    int dma_channel(int isegment = 0) const { return segment_[isegment].dma_chan; }
     bool program_activated() const { return program_activated_; }
 
     void activate_program();
     void deactivate_program();
 
-    inline void put_pixel(uint32_t pixel_code) const {
-        hard_assert(program_activated_);
-        pio_sm_put_blocking(pio_, sm_, pixel_code);
+    // Pixels written by the CPU go to the first segment only, and can not be
+    // used when the latch is generated by the state machines
+    inline void put_pixel(uint32_t pixel_code) {
+        hard_assert(program_activated_ and !latch_in_pio());
+        wait_for_latch();
+        pio_sm_put_blocking(segment_[0].pio, segment_[0].sm, pixel_code);
+        cpu_words_pending_ = true;
     }
-    inline void put_pixel(uint32_t pixel_code, uint32_t nled) const {
-        hard_assert(program_activated_);
+    inline void put_pixel(uint32_t pixel_code, uint32_t nled) {
+        hard_assert(program_activated_ and !latch_in_pio());
+        wait_for_latch();
         for(unsigned i=0; i<nled; i++) {
-            pio_sm_put_blocking(pio_, sm_, pixel_code);
+            pio_sm_put_blocking(segment_[0].pio, segment_[0].sm, pixel_code);
         }
+        cpu_words_pending_ = true;
     }
-    inline void put_pixel_vector(std::vector<uint32_t>& pixel_codes) const {
-        hard_assert(program_activated_);
+    inline void put_pixel_vector(std::vector<uint32_t>& pixel_codes) {
+        hard_assert(program_activated_ and !latch_in_pio());
+        wait_for_latch();
         for(uint32_t pixel_code : pixel_codes) {
-            pio_sm_put_blocking(pio_, sm_, pixel_code);
+            pio_sm_put_blocking(segment_[0].pio, segment_[0].sm, pixel_code);
+        }
+        cpu_words_pending_ = true;
+    }
+
+    // The DMA functions below take pixels for the whole chain. When it is
+    // split into nsegment() segments, on pins pin() to pin()+nsegment()-1,
+    // segment k receives pixels k*segment_nled() to (k+1)*segment_nled()-1,
+    // and all segments are started together and latched together. The frame
+    // time is then that of the longest segment.
+    //
+    // Clocked chips take two pins per segment, the clock on pin()+2*k and the
+    // data on the pin after. Each segment sent gets a start frame before its
+    // pixels and enough zero words after them to clock the data through its
+    // chain, and the pixels are sent as APA102 frames : the frame buffers and
+    // spans are converted with levels_to_apa102 (taking the corrected levels
+    // with their 8 extra bits) or grbz_to_apa102, and RGBW mode is ignored.
+    // Codes sent with put_pixel and put_pixel_array_dma are sent as is.
+    //
+    // With pio_latch() set, the WS2812 chips are driven by the ws2812_latched
+    // program, and each segment sent gets a header word giving its number of
+    // bits and the length of the latch, which the state machine then holds
+    // the line low for itself. A frame is started as soon as the previous one
+    // has been handed to the FIFO, without waiting for the latch alarm, and
+    // the state machine keeps the frames apart; the alarm still marks the end
+    // of the last latch for latch_complete() and flush().
+
+    // Hand the pixel codes to the DMA channel, which feeds the state machine
+    // paced by its TX DREQ, and return immediately. The buffer must not be
+    // modified until transmit_complete() returns true (or the callback is
+    // called from the DMA interrupt). If the previous frame is still being
+    // latched the transfer is queued and started from the latch alarm.
+    void put_pixel_array_dma(const uint32_t* pixel_codes, unsigned npixel);
+    inline void put_pixel_vector_dma(const std::vector<uint32_t>& pixel_codes) {
+        put_pixel_array_dma(pixel_codes.data(), pixel_codes.size());
+    }
+    // In RGBW mode the codes passed to put_pixel and put_pixel_array_dma are
+    // sent as is (grbw), while the frame buffers and spans are given in grbz
+    // and converted with grbz_to_grbw on the way out, so effects need not
+    // know about the white channel. Likewise the frame buffers and spans go
+    // through the gamma and brightness correction of post_processor(), in
+    // the same pass as the conversion, unless the spans ask otherwise. If a
+    // budget is set in power_limiter(), the channel levels are summed in that
+    // pass too (or span by span), and a frame estimated to draw more current
+    // than the budget is scaled down to it. Codes sent with put_pixel and
+    // put_pixel_array_dma are not limited.
+
+    // Send runs of identical pixels, each streamed by DMA from a single word
+    // without incrementing the read address, so solid fills and blanking cost
+    // no CPU time or buffer memory whatever the length of the chain. The spans
+    // are copied and can be reused when the call returns.
+    void put_pixel_spans_dma(const PixelSpan* spans, unsigned nspan, bool post_process = true);
+    inline void put_pixel_spans_dma(std::initializer_list<PixelSpan> spans, bool post_process = true) {
+        put_pixel_spans_dma(spans.begin(), spans.size(), post_process);
+    }
+    inline void put_pixel_run_dma(uint32_t pixel_code, unsigned npixel) {
+        PixelSpan span = { pixel_code, npixel };
+        put_pixel_spans_dma(&span, 1);
+    }
+
+    inline bool transmit_complete() const { return !transmit_active_ and !frame_pending_; }
+    inline void wait_for_transmit() const {
+        while(!transmit_complete()) {
+            tight_loop_contents();
         }
     }
-    inline void flush() const {
-        uint32_t stall_mask = 1u << (PIO_FDEBUG_TXSTALL_LSB + sm_);
-        hard_assert(program_activated_);
-        pio_->fdebug = stall_mask;
-        busy_wait_us(1);
-        while (!(pio_->fdebug & stall_mask)) {
-            busy_wait_us(1);
+    inline bool latch_complete() const { return transmit_complete() and !latch_pending_; }
+    inline void wait_for_latch() const {
+        while(!latch_complete()) {
+            tight_loop_contents();
         }
-        busy_wait_us(50); // + 24000000 / baud_rate_);
+    }
+    void set_transmit_complete_callback(TransmitCompleteCallback callback,
+        void* callback_arg = nullptr);
+
+    // Pair of frame buffers of non() pixels owned by the output, allocated
+    // (and blanked) by activate_program(). Effects render into the back buffer
+    // while the front buffer is transmitted by DMA; send_frame() waits for the
+    // front buffer to be sent, swaps the two and queues the new front buffer
+    // to be sent as soon as the previous frame has been latched. The other
+    // nled()-non() pixels are blanked with a span before (if back() is set) or
+    // after the buffer. In RGBW mode the white level is extracted in place as
+    // the frame is queued, so the front buffer then holds grbw codes.
+    //
+    // The LEDs keep their state if they receive no bits before the latch, so
+    // when the chain is showing the previous frame, each segment is only sent
+    // up to its last pixel that differs from it (and the padding, which never
+    // changes, is left out). A frame whose hash matches that of the front
+    // buffer is not sent at all (nor latched), and is counted as skipped.
+    // Every refresh_interval() frames the whole chain is sent, to recover from
+    // any glitch (or hash collision); an interval of zero disables all this.
+    inline std::vector<uint32_t>& back_buffer() { return frame_buffer_[1-front_buffer_]; }
+    inline const std::vector<uint32_t>& front_buffer() const { return frame_buffer_[front_buffer_]; }
+    void send_frame();
+    uint32_t skipped_frame_count() const { return frame_filter_.skipped_frame_count(); }
+
+    // Periodic frames : a pattern repeating every nperiod pixels (a power of
+    // two from 2 to MAX_RING_PIXELS) is rendered once, in grbz, into
+    // ring_buffer(nperiod), and commit_ring() corrects and converts it as
+    // send_frame() would, into the second of a pair of buffers aligned on
+    // their size. send_ring_frame(start) then sends non() pixels starting at
+    // pixel start of the period, with the DMA read address wrapping around
+    // the first buffer (swapped with the second if it was committed), and the
+    // padding blanked as for frames. Scrolling the pattern only moves start,
+    // and costs no CPU time. The power estimate counts non()/nperiod periods.
+    // Ring frames are not dithered and do not use prefixes or skipping. The
+    // buffers are freed when the program is deactivated, after which
+    // ring_nperiod() is zero and the pattern must be committed again.
+    static bool ring_period_supported(unsigned nperiod) {
+        return nperiod >= 2 and nperiod <= MAX_RING_PIXELS and (nperiod & (nperiod-1)) == 0;
+    }
+    std::vector<uint32_t>& ring_buffer(unsigned nperiod);
+    unsigned ring_nperiod() const { return ring_nperiod_; }
+    void commit_ring();
+    void send_ring_frame(unsigned start);
+
+    // Temporal dithering : send_frame() keeps the corrected levels of each
+    // pixel with 8 more bits than the LEDs take, and every frame sent adds
+    // them to a per-pixel error accumulator, sending its top 8 bits and
+    // keeping the rest for the next one. Between effect frames the output
+    // driver calls send_dithered_frame() each time the latch has completed,
+    // so the chain is refreshed at the full wire rate and the mean level of
+    // each LED has the full precision. Prefixes and identical frame skipping
+    // are not used; spans are sent without dithering.
+    bool dithered_frame_ready() const {
+        return dither_ and dither_level_valid_ and (latch_in_pio() ? transmit_complete() : latch_complete());
+    }
+    void send_dithered_frame();
+    uint32_t dithered_frame_count() const { return dithered_frame_count_; }
+
+    // Estimated current of the last frame sent (after any limiting), and the
+    // number of frames that had to be scaled down, when the budget is set
+    uint32_t current_ma() const { return current_ma_; }
+    uint32_t limited_frame_count() const { return limited_frame_count_; }
+
+    // Wait until everything sent has been latched by the LEDs
+    void flush();
+
+    // Duration of the transmission and of the latch of the last frame sent
+    // by DMA, measured by its interrupts, and the number of frames timed
+    uint32_t frame_timing(uint32_t& transmit_us, uint32_t& latch_us) const;
+
+    // Statistics of the frames sent, published from time to time by whoever
+    // drives the output (the OutputEngine on core 1) and read by the menu.
+    // frame_stats() returns true if they have changed since seq.
+    void publish_frame_stats(const FrameStats& stats) { frame_stats_.write(stats); }
+    bool frame_stats(FrameStats& stats, uint32_t& seq) const {
+        return frame_stats_.read_if_newer(stats, seq);
     }
 
 protected:
@@ -124,15 +326,212 @@ protected:
     SerialPIO& operator=(const SerialPIO&) = delete;
 
     int pin_ = 28;
+    int nsegment_ = 1;
+    int chip_ = CHIP_WS2812;
     int baudrate_ = 800000;
     int nled_ = 0;
     int non_ = 0;
     bool back_ = false;
+    int latch_us_ = 300;
+    bool rgbw_ = false;
+    int refresh_interval_ = 50;
+    bool dither_ = false;
+    bool pio_latch_ = false;
+    PostProcessor post_processor_;
+    PowerLimiter power_limiter_;
+
+    bool program_activated_ = false;
+    // Copy of the ws2812 program with the delays of the chip profile, sized
+    // for the whole of the PIO instruction memory
+    uint16_t program_instructions_[32];
+    pio_program_t program_;
+    // DMA interrupt line of the core that activated the program
+    uint dma_irq_index_ = 0;
+    int latch_alarm_ = -1;
+    uint32_t word_time_us_ = 0;
+    uint32_t pio_latch_cycles_ = 0;
+    uint32_t pio_latch_us_ = 0;
+    dma_channel_config dma_buffer_config_;
+    dma_channel_config dma_run_config_;
+
+    std::vector<uint32_t> frame_buffer_[2];
+    int front_buffer_ = 0;
+
+    // The chain is showing the front buffer (nothing else has been sent since
+    // it was)
+    bool front_buffer_sent_ = false;
+    FrameFilter frame_filter_;
+
+    // Levels (green, red, blue, in 1/256 of an output level) of the last
+    // frame passed to send_frame() and the dithering error of each, when
+    // dithering
+    std::vector<uint16_t> dither_level_;
+    std::vector<uint8_t> dither_error_;
+    bool dither_level_valid_ = false;
+    uint32_t dithered_frame_count_ = 0;
+
+    volatile uint32_t current_ma_ = 0;
+    uint32_t limited_frame_count_ = 0;
+
+    // Pattern of the ring frames and the pair of buffers it is committed to,
+    // allocated together, aligned on the size of the pair
+    std::vector<uint32_t> ring_pattern_;
+    uint32_t* ring_wire_ = nullptr;
+    unsigned ring_nperiod_ = 0;
+    int ring_front_ = 0;
+    bool ring_committed_ = false;
+
+    // DMA transfer in progress, transfer waiting for the latch to complete,
+    // and latch in progress (state machine draining its FIFO, then line held
+    // low for latch_us_). Set on the core that activated the program and
+    // cleared from its DMA and alarm interrupts.
+    volatile bool transmit_active_ = false;
+    volatile bool frame_pending_ = false;
+    volatile bool latch_pending_ = false;
+
+    // Buffer or run making up part of a transmission. A buffer read with
+    // ring_bits set wraps around the 1<<ring_bits bytes it is aligned on.
+    struct TxBlock {
+        const uint32_t* pixel_codes; // nullptr for a run of fill_code
+        uint32_t fill_code;
+        unsigned npixel;
+        uint8_t ring_bits;
+    };
+
+    // Blocks of the transmission being assembled for the whole chain
+    TxBlock tx_block_[MAX_TX_BLOCKS];
+    unsigned tx_nblock_ = 0;
+
+    // State machine and DMA channel driving each segment of the chain, with
+    // its share of the transmission in progress (or pending), whose blocks
+    // are sent one after the other from the DMA interrupt. The program is
+    // loaded once in each PIO, by the first segment there (owns_program),
+    // and the others in the same PIO run it from the same offset.
+    struct OutputSegment {
+        PIO pio;
+        uint sm;
+        uint offset;
+        bool owns_program = false;
+        int dma_chan = -1;
+        TxBlock tx_block[MAX_TX_BLOCKS + 2]; // with the start and end frames, or header
+        unsigned tx_nblock = 0;
+        unsigned tx_iblock = 0;
+    };
+    OutputSegment segment_[MAX_SEGMENTS];
+    bool claim_sm_with_program(int iseg, uint seg_pin, uint npin);
+    volatile int tx_nsegment_active_ = 0;
+
+    // Words written to the FIFO by the CPU through put_pixel, which are
+    // latched by flush() by waiting for the state machine to stall
+    bool cpu_words_pending_ = false;
+
+    TransmitCompleteCallback transmit_complete_callback_ = nullptr;
+    void* transmit_complete_callback_arg_ = nullptr;
+
+    // Timing of the transmission in progress, and of the last one latched
+    uint32_t tx_start_us_ = 0;
+    uint32_t tx_end_us_ = 0;
+    volatile uint32_t last_transmit_us_ = 0;
+    volatile uint32_t last_latch_us_ = 0;
+    volatile uint32_t timed_frame_count_ = 0;
+
+    SeqLock<FrameStats> frame_stats_;
+
+private:
+    void begin_transmit();
+    void add_tx_block(const uint32_t* pixel_codes, uint32_t fill_code, unsigned npixel,
+        uint8_t ring_bits = 0);
+    void free_ring();
+    void split_tx_blocks();
+    uint32_t limit_power(const PowerLimiter::LevelSums& sums);
+    void encode_clocked_frame(std::vector<uint32_t>& frame, bool limit);
+    void add_clocked_frames(OutputSegment& segment);
+    void add_latch_header(OutputSegment& segment);
+    void truncate_tx_blocks(OutputSegment& segment, unsigned npixel);
+    void queue_transmit(const unsigned* segment_npixel = nullptr);
+    void start_transmit();
+    void start_tx_block(OutputSegment& segment, bool trigger);
+    void block_complete_irq(OutputSegment& segment);
+    void transmit_complete_irq(const OutputSegment& segment);
+    void latch_complete_irq();
+    static void dma_irq0_handler();
+    static void dma_irq1_handler();
+    static void dma_irq_handler(uint irq_index);
+    static void latch_alarm_handler(uint alarm_num);
+};
+
+// Drive up to 32 WS2812 strips from consecutive GPIOs using one state machine
+// running the ws2812_parallel program. Each word sent to the state machine
+// holds one bit slot for all strips : bit i of the word is the bit of strip i,
+// with 24 words per pixel, starting with the most significant bit of the grbz
+// code. Strips are rendered into per-strip frame buffers in the usual grbz
+// format and transposed into bit slots chunk by chunk while the previous chunk
+// is transmitted by DMA.
+class ParallelPIO {
+public:
+    static constexpr int MAX_STRIPS = 32;
+
+    ParallelPIO(int pin_base, int nstrip, int baudrate = 800000);
+    ~ParallelPIO();
+
+    int pin_base() const { return pin_base_; }
+    int nstrip() const { return nstrip_; }
+    int baudrate() const { return baudrate_; }
+    int nled() const { return nled_; }
+    int latch_us() const { return latch_us_; }
+
+    void set_pin_base(int pin_base);
+    void set_nstrip(int nstrip);
+    void set_baudrate(int baudrate);
+    void set_nled(int nled);
+    void set_latch_us(int latch_us) { latch_us_ = latch_us; }
+
+    PIO pio() const { return pio_; }
+    uint sm() const { return sm_; }
+    bool program_activated() const { return program_activated_; }
+
+    void activate_program();
+    void deactivate_program();
+
+    // Frame buffer of nled() grbz codes for each strip, allocated (and blanked)
+    // by activate_program()
+    inline std::vector<uint32_t>& strip_buffer(int istrip) { return strip_buffer_[istrip]; }
+
+    // Wait for the previous frame to be latched, then transpose and transmit
+    // the strip buffers. Returns when the last chunk has been handed to DMA, at
+    // which point the strip buffers can be reused for the next frame. The
+    // latch ends latch_us() after the last word leaves the FIFO, a time
+    // bounded when the last chunk is started, so flush() only sleeps for what
+    // is left of it, if anything.
+    void send_frame();
+    void flush() const;
+
+protected:
+    ParallelPIO(const ParallelPIO&) = delete;
+    ParallelPIO& operator=(const ParallelPIO&) = delete;
+
+    // Number of pixels transposed per DMA transfer. Transposing a chunk (see
+    // grbz_to_bit_slots) must take less time than sending one (16 pixels =
+    // 480us at 800kbps) or the gap between chunks will be seen as a reset.
+    static constexpr int CHUNK_NLED = 16;
+
+    void transpose_chunk(uint32_t* bit_slots, int iled0, int nled) const;
+
+    int pin_base_ = 0;
+    int nstrip_ = 1;
+    int baudrate_ = 800000;
+    int nled_ = 0;
+    int latch_us_ = CHIP_PROFILES[CHIP_WS2812].latch_us;
+    absolute_time_t latch_end_ = nil_time;
+
+    std::vector<std::vector<uint32_t> > strip_buffer_;
+    std::vector<uint32_t> chunk_buffer_[2];
 
     bool program_activated_ = false;
     PIO pio_;
     uint sm_;
-    uint offset_;  
+    uint offset_;
+    int dma_chan_ = -1;
 };
 
 class SerialPIOMenu: public SerialPIO, public SimpleItemValueMenu, public SavedStateSupplierConsumer {
@@ -150,18 +549,30 @@ public:
 
     std::vector<int32_t> get_saved_state() override;
     bool set_saved_state(const std::vector<int32_t>& state) override;
+    bool set_old_saved_state(int32_t version, const std::vector<int32_t>& state) override;
     int32_t get_version() override;
     int32_t get_supplier_id() override;
 
 private:
     enum MenuItemPositions {
         MIP_PIN,
+        MIP_NSEGMENT,
+        MIP_CHIP,
         MIP_BAUDRATE,
         MIP_NLED,
         MIP_NON,
         MIP_BACK,
+        MIP_LATCH,
+        MIP_PIO_LATCH,
+        MIP_REFRESH,
+        MIP_RGBW,
+        MIP_GAMMA,
+        MIP_BRIGHTNESS,
+        MIP_DITHER,
+        MIP_POWER,
         MIP_LAMP_TEST,
         MIP_FRAME_RATE,
+        MIP_MEASURED,
         MIP_EXIT,
         MIP_NUM_ITEMS // MUST BE LAST ITEM IN LIST
     };
@@ -169,21 +580,48 @@ private:
     void enable_lamp_test();
     void disable_lamp_test();
     void send_color_string();
+    bool set_saved_state_prefix(const std::vector<int32_t>& state, int32_t version);
 
     void set_pin_value(bool draw = true);
+    void set_nsegment_value(bool draw = true);
+    void set_chip_value(bool draw = true);
     void set_baudrate_value(bool draw = true);
     void set_nled_value(bool draw = true);
     void set_non_value(bool draw = true);
     void set_back_value(bool draw = true);
+    void set_latch_value(bool draw = true);
+    void set_pio_latch_value(bool draw = true);
+    void set_refresh_value(bool draw = true);
+    void set_rgbw_value(bool draw = true);
+    void set_gamma_value(bool draw = true);
+    void set_brightness_value(bool draw = true);
+    void set_dither_value(bool draw = true);
+    void set_power_value(bool draw = true);
     void set_lamp_test_value(bool draw = true);
     void set_frame_rate_value(bool draw = true);
+    void set_measured_value(bool draw = true);
     
     std::vector<MenuItem> make_menu_items();
 
 private:
+    // What the measured item shows of the last window, cycled by 'S'
+    enum MeasuredView {
+        MV_RATE,
+        MV_COUNTS,
+        MV_CURRENT,
+        MV_RENDER,
+        MV_TRANSMIT,
+        MV_LATCH,
+        MV_IDLE,
+        NUM_MEASURED_VIEWS // MUST BE LAST ITEM IN LIST
+    };
+
     int lamp_test_cycle_ = -1;
     int lamp_test_count_ = 0;
     unsigned heartbeat_timer_count_ = 0;
+    FrameStats measured_stats_ = { };
+    int measured_view_ = MV_RATE;
+    uint32_t measured_stats_seq_ = 0;
 };
 
 #define MAX_PIXELS 32*8*8
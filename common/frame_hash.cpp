@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#if PICO_ON_DEVICE
+#include <hardware/dma.h>
+#endif
+
+#include "build_date.hpp"
+#include "frame_hash.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+
+    static constexpr uint32_t CRC32_SEED = 0xFFFFFFFF;
+
+#if PICO_ON_DEVICE
+    // Destination of the sniffed transfers, whose contents do not matter
+    static uint32_t dma_sink;
+#else
+    // CRC32 with the polynomial of the sniffer, a bit at a time, which is
+    // slow but only used on the host
+    static uint32_t crc32_words(const uint32_t* words, unsigned nword)
+    {
+        uint32_t crc = CRC32_SEED;
+        for(unsigned iword=0; iword<nword; iword++) {
+            crc ^= words[iword];
+            for(int ibit=0; ibit<32; ibit++) {
+                crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1);
+            }
+        }
+        return crc;
+    }
+#endif
+}
+
+FrameHasher::FrameHasher()
+{
+    // nothing to see here
+}
+
+FrameHasher::~FrameHasher()
+{
+    if(dma_chan_ >= 0) {
+        unclaim();
+    }
+}
+
+void FrameHasher::claim()
+{
+#if PICO_ON_DEVICE
+    hard_assert(dma_chan_ < 0);
+    dma_chan_ = dma_claim_unused_channel(true);
+#endif
+}
+
+void FrameHasher::unclaim()
+{
+#if PICO_ON_DEVICE
+    hard_assert(dma_chan_ >= 0);
+    dma_channel_unclaim(dma_chan_);
+    dma_chan_ = -1;
+#endif
+}
+
+uint32_t FrameHasher::hash(const uint32_t* words, unsigned nword)
+{
+#if PICO_ON_DEVICE
+    hard_assert(dma_chan_ >= 0);
+    // Unpaced (DREQ_FORCE) transfer to a single word, with the sniffer
+    // accumulating the CRC of everything read
+    dma_channel_config c = dma_channel_get_default_config(dma_chan_);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+    dma_sniffer_set_data_accumulator(CRC32_SEED);
+    dma_sniffer_enable(dma_chan_, DMA_SNIFF_CTRL_CALC_VALUE_CRC32, true);
+    dma_channel_configure(dma_chan_, &c, &dma_sink, words, nword, true);
+    dma_channel_wait_for_finish_blocking(dma_chan_);
+    uint32_t crc = dma_sniffer_get_data_accumulator();
+    dma_sniffer_disable();
+    return crc;
+#else
+    return crc32_words(words, nword);
+#endif
+}
+
+FrameFilter::Action FrameFilter::filter(const uint32_t* frame, unsigned nword,
+    int refresh_interval, bool last_frame_shown)
+{
+    bool send_prefix = last_frame_shown and refresh_interval > 0
+        and ++frames_since_refresh_ < refresh_interval;
+    // The hash is of the frame as it is sent
+    uint32_t hash = 0;
+    if(refresh_interval > 0) {
+        hash = hasher_.hash(frame, nword);
+        if(send_prefix and hash == last_hash_) {
+            ++skipped_frame_count_;
+            return SKIP;
+        }
+    }
+    last_hash_ = hash;
+    if(!send_prefix) {
+        frames_since_refresh_ = 0;
+        return SEND_FULL;
+    }
+    return SEND_PREFIX;
+}
+
+unsigned changed_prefix(const uint32_t* frame, const uint32_t* last_frame, unsigned nword,
+    unsigned ichain0, unsigned ichain1, unsigned offset)
+{
+    unsigned i0 = std::max(ichain0, offset) - offset;
+    unsigned i1 = std::min(std::max(ichain1, offset) - offset, nword);
+    for(unsigned i=i1; i>i0; i--) {
+        if(frame[i-1] != last_frame[i-1]) {
+            return i + offset - ichain0;
+        }
+    }
+    return 0;
+}
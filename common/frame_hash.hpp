@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+// CRC32 of a frame of pixel codes, used to recognise a frame identical to
+// the last one sent. On the device the words are streamed through the DMA
+// sniffer by a channel of our own, which takes about one cycle per word; in
+// host builds (PICO_ON_DEVICE=0) it is computed in software. The two do not
+// give the same value, hashes are only ever compared with others from the
+// same hasher.
+class FrameHasher {
+public:
+    FrameHasher();
+    ~FrameHasher();
+
+    // Claim (and release) the DMA channel, on the device
+    void claim();
+    void unclaim();
+
+    uint32_t hash(const uint32_t* words, unsigned nword);
+
+private:
+    FrameHasher(const FrameHasher&) = delete;
+    FrameHasher& operator=(const FrameHasher&) = delete;
+
+    int dma_chan_ = -1;
+};
+
+// Decides how much of each frame has to be sent, given the last one sent.
+// Between full refreshes, every refresh_interval frames, a frame whose hash
+// matches that of the last one is skipped and the others are sent up to
+// their last changed pixel (see changed_prefix). An interval of zero sends
+// every frame in full.
+class FrameFilter {
+public:
+    enum Action { SEND_FULL, SEND_PREFIX, SKIP };
+
+    void claim() { hasher_.claim(); }
+    void unclaim() { hasher_.unclaim(); }
+
+    // Choose what to do with the next frame, which the caller must then send
+    // unless SKIP is returned. last_frame_shown is false if the chain is not
+    // showing the last frame passed here, because something else was sent.
+    Action filter(const uint32_t* frame, unsigned nword, int refresh_interval,
+        bool last_frame_shown);
+    uint32_t skipped_frame_count() const { return skipped_frame_count_; }
+
+private:
+    FrameHasher hasher_;
+    int frames_since_refresh_ = 0;
+    uint32_t last_hash_ = 0;
+    uint32_t skipped_frame_count_ = 0;
+};
+
+// Number of pixels from chain position ichain0 up to the last one before
+// ichain1 at which frame (of nword pixels, starting at chain position offset)
+// differs from last_frame, searching from the end
+unsigned changed_prefix(const uint32_t* frame, const uint32_t* last_frame, unsigned nword,
+    unsigned ichain0, unsigned ichain1, unsigned offset);
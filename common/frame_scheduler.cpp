@@ -0,0 +1,100 @@
+#include <pico/time.h>
+#include <hardware/timer.h>
+#include <hardware/sync.h>
+
+#include "build_date.hpp"
+#include "frame_scheduler.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+
+    // Hardware alarms used for the frame deadlines, with their scheduler
+    static FrameScheduler* frame_alarm_owner[NUM_ALARMS] = { };
+}
+
+FrameScheduler::FrameScheduler()
+{
+    // nothing to see here
+}
+
+FrameScheduler::~FrameScheduler()
+{
+    if(running()) {
+        stop();
+    }
+}
+
+void FrameScheduler::start(uint32_t period)
+{
+    hard_assert(!running() and period > 0);
+    period_ = period;
+    uint64_t now = uint64_t(to_us_since_boot(get_absolute_time())) << FRAC_BITS;
+    last_deadline_ = now;
+    next_deadline_ = now;
+    deadline_count_ = 1;
+    frame_count_ = 0;
+    missed_count_ = 0;
+    max_late_us_ = 0;
+
+    alarm_ = hardware_alarm_claim_unused(true);
+    frame_alarm_owner[alarm_] = this;
+    hardware_alarm_set_callback(alarm_, &FrameScheduler::alarm_handler);
+
+    // The first deadline is now, arm the alarm for the second
+    uint32_t irq_state = save_and_disable_interrupts();
+    next_deadline_ += period_;
+    if(hardware_alarm_set_target(alarm_, deadline_time(next_deadline_))) {
+        alarm_irq();
+    }
+    restore_interrupts(irq_state);
+}
+
+void FrameScheduler::stop()
+{
+    hard_assert(running());
+    hardware_alarm_cancel(alarm_);
+    hardware_alarm_set_callback(alarm_, nullptr);
+    frame_alarm_owner[alarm_] = nullptr;
+    hardware_alarm_unclaim(alarm_);
+    alarm_ = -1;
+}
+
+uint32_t FrameScheduler::take_frame()
+{
+    // The deadline is 64 bits, so it is copied with the alarm held off
+    uint32_t irq_state = save_and_disable_interrupts();
+    uint32_t deadline_count = deadline_count_;
+    uint64_t last_deadline = last_deadline_;
+    restore_interrupts(irq_state);
+
+    missed_count_ += deadline_count - frame_count_ - 1;
+    frame_count_ = deadline_count;
+
+    int64_t late_us = absolute_time_diff_us(deadline_time(last_deadline), get_absolute_time());
+    uint32_t late = late_us > 0 ? uint32_t(late_us) : 0;
+    if(late > max_late_us_) {
+        max_late_us_ = late;
+    }
+    return late;
+}
+
+void FrameScheduler::alarm_irq()
+{
+    // Deadlines that have already passed when the alarm is set (because the
+    // interrupt was held off for longer than a period) are counted here, and
+    // the alarm is set for the first one in the future
+    do {
+        last_deadline_ = next_deadline_;
+        deadline_count_ = deadline_count_ + 1;
+        next_deadline_ += period_;
+    } while(hardware_alarm_set_target(alarm_, deadline_time(next_deadline_)));
+    __sev();
+}
+
+void FrameScheduler::alarm_handler(uint alarm_num)
+{
+    FrameScheduler* owner = frame_alarm_owner[alarm_num];
+    if(owner) {
+        owner->alarm_irq();
+    }
+}
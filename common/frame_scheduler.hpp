@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+#include "pico/time.h"
+#include "hardware/timer.h"
+
+// Deadlines for the frames of an effect, kept by a hardware alarm so that
+// they fall on an exact grid whatever the code waiting for them is doing.
+// The alarm interrupt is taken on the core that calls start(), which should
+// then poll frame_due(), sleeping with __wfe() between polls as the alarm
+// sends an event when a deadline passes. Deadlines are kept in 1/256 us so
+// that rates which are not a whole number of microseconds do not drift.
+//
+// If more than one deadline passes before the frame for the first of them is
+// taken, the extra ones are counted as missed and skipped, so an effect that
+// falls behind runs slower rather than sending a burst of frames to catch up.
+class FrameScheduler {
+public:
+    FrameScheduler();
+    ~FrameScheduler();
+
+    static constexpr uint32_t FRAC_BITS = 8;
+
+    // Slowest rate whose period fits in 32 bits, about one frame in 16 s
+    static constexpr uint32_t MIN_RATE_MHZ = 60;
+
+    // Frame period in 1/256 us for an interval in us, and for a rate in mHz,
+    // which is clamped to MIN_RATE_MHZ (so a rate of zero runs at that)
+    static constexpr uint32_t period_from_interval_us(uint32_t interval_us) {
+        return interval_us << FRAC_BITS;
+    }
+    static constexpr uint32_t period_from_rate_mhz(uint32_t rate_mhz) {
+        const uint32_t rate = rate_mhz < MIN_RATE_MHZ ? MIN_RATE_MHZ : rate_mhz;
+        return uint32_t(((1000000000ULL << FRAC_BITS) + rate/2) / rate);
+    }
+
+    // Start with the first deadline now (so a frame is due immediately)
+    void start(uint32_t period);
+    void stop();
+
+    bool running() const { return alarm_ >= 0; }
+    uint32_t period() const { return period_; }
+
+    // True if a deadline has passed whose frame has not been taken
+    bool frame_due() const { return deadline_count_ != frame_count_; }
+
+    // Take the due frame, returning how late it is in us. Deadlines passed
+    // since the previous frame are added to the missed count.
+    uint32_t take_frame();
+
+    uint32_t frame_count() const { return frame_count_; }
+    uint32_t missed_count() const { return missed_count_; }
+    uint32_t max_late_us() const { return max_late_us_; }
+
+private:
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    absolute_time_t deadline_time(uint64_t deadline) const {
+        return from_us_since_boot(deadline >> FRAC_BITS);
+    }
+
+    void alarm_irq();
+    static void alarm_handler(uint alarm_num);
+
+    int alarm_ = -1;
+    uint32_t period_ = 0;
+
+    // Next deadline to be set on the alarm, in 1/256 us since boot, and the
+    // last one to have passed, both only written by the alarm interrupt
+    uint64_t next_deadline_ = 0;
+    volatile uint64_t last_deadline_ = 0;
+    volatile uint32_t deadline_count_ = 0;
+
+    uint32_t frame_count_ = 0;
+    uint32_t missed_count_ = 0;
+    uint32_t max_late_us_ = 0;
+};
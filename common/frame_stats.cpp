@@ -0,0 +1,30 @@
+#include <cstring>
+
+#include "build_date.hpp"
+#include "frame_stats.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+}
+
+void TimeStats::reset()
+{
+    std::memset(this, 0, sizeof(*this));
+}
+
+void FrameStats::reset()
+{
+    window_us = 0;
+    nframe = 0;
+    nmissed = 0;
+    nskipped = 0;
+    ndithered = 0;
+    nlimited = 0;
+    current_ma_sum = 0;
+    current_ma_max = 0;
+    core0_idle_us = 0;
+    render.reset();
+    transmit.reset();
+    latch.reset();
+    idle.reset();
+}
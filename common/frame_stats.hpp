@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+// Distribution of a time measured once per frame : count, minimum, mean and
+// maximum, and a histogram in powers of two, in which bin 0 counts times of
+// 0us, bin k times from 2^(k-1) to 2^k-1 us and the last bin everything
+// longer. Plain data, so it can be published through a SeqLock.
+struct TimeStats {
+    static constexpr int NBIN = 18;
+
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t sum_us;
+    uint16_t hist[NBIN];
+
+    static int bin(uint32_t us) {
+        int ibin = us ? 32 - __builtin_clz(us) : 0;
+        return ibin < NBIN ? ibin : NBIN-1;
+    }
+
+    void reset();
+    void add(uint32_t us) {
+        if(count == 0 or us < min_us) { min_us = us; }
+        if(count == 0 or us > max_us) { max_us = us; }
+        ++count;
+        sum_us += us;
+        int ibin = bin(us);
+        if(hist[ibin] != UINT16_MAX) { ++hist[ibin]; }
+    }
+    uint32_t mean_us() const { return count ? (sum_us + count/2) / count : 0; }
+};
+
+// Performance of the output over a window of about a second, gathered on
+// core 1 by the OutputEngine. The render time runs from the frame being taken
+// from the scheduler to the generator returning, the transmit time from the
+// DMA being started to the last word leaving the state machine FIFOs, and the
+// latch time from there to the end of the latch. Frames identical to the one
+// before are not sent, and are counted as skipped, while all the frames sent
+// by temporal dithering (those of the effect included) are counted apart.
+// The idle time is that spent by core 1 waiting for each frame deadline,
+// less that spent dithering, and that of core 0 the time its menu event loop
+// spent waiting for input. When a power budget is set, the current estimated
+// for each frame is summed, and the frames scaled down to the budget counted.
+struct FrameStats {
+    uint32_t window_us;
+    uint32_t nframe;
+    uint32_t nmissed;
+    uint32_t nskipped;
+    uint32_t ndithered;
+    uint32_t nlimited;
+    uint32_t current_ma_sum;
+    uint32_t current_ma_max;
+    uint32_t core0_idle_us;
+    TimeStats render;
+    TimeStats transmit;
+    TimeStats latch;
+    TimeStats idle;
+
+    void reset();
+
+    // Frames per second x 1000, and load of each core in units of 0.1%
+    uint32_t frame_rate_mhz() const {
+        return window_us ? uint32_t((uint64_t(nframe) * 1000000000ULL + window_us/2) / window_us) : 0;
+    }
+    int core0_load_permille() const { return load_permille(core0_idle_us); }
+    int core1_load_permille() const { return load_permille(idle.sum_us); }
+    uint32_t mean_current_ma() const { return nframe ? (current_ma_sum + nframe/2) / nframe : 0; }
+
+private:
+    int load_permille(uint32_t idle_us) const {
+        if(window_us == 0 or idle_us >= window_us) {
+            return 0;
+        }
+        return 1000 - int((uint64_t(idle_us) * 1000 + window_us/2) / window_us);
+    }
+};
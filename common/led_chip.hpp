@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+
+// Bit timing of the WS2812 family of LED chips. The ws2812 PIO program sends
+// each bit in T1+T2+T3 cycles : high for T1 (a zero) or T1+T2 (a one), then
+// low for the rest. The profiles give the cycle counts, the bit rate, and the
+// latch (reset) time for each chip, and the windows from its datasheet within
+// which the high and low times of both bits must fall, in ns, with the
+// shortest low time that it takes as a reset, in us. Clocked chips
+// (APA102, SK9822) are driven by the apa102 program instead, on a clock and a
+// data pin, and only use the bit rate and latch time.
+struct ChipTimingWindow {
+    uint32_t t0h_min, t0h_max;
+    uint32_t t1h_min, t1h_max;
+    uint32_t t0l_min, t0l_max;
+    uint32_t t1l_min, t1l_max;
+    uint32_t latch_min_us;
+};
+
+struct ChipProfile {
+    const char* name;
+    uint8_t t1;
+    uint8_t t2;
+    uint8_t t3;
+    uint32_t baudrate;
+    uint32_t latch_us;
+    ChipTimingWindow window;
+    bool clocked = false;
+
+    constexpr uint32_t cycles_per_bit() const { return t1 + t2 + t3; }
+
+    // Nominal duration of ncycle PIO cycles, in ns
+    constexpr uint32_t cycles_ns(uint32_t ncycle) const {
+        return uint32_t((uint64_t(ncycle) * 1000000000ULL + baudrate*cycles_per_bit()/2)
+            / (uint64_t(baudrate) * cycles_per_bit()));
+    }
+    constexpr uint32_t t0h_ns() const { return cycles_ns(t1); }
+    constexpr uint32_t t1h_ns() const { return cycles_ns(t1 + t2); }
+    constexpr uint32_t t0l_ns() const { return cycles_ns(t2 + t3); }
+    constexpr uint32_t t1l_ns() const { return cycles_ns(t3); }
+
+    // The side-set leaves four bits of delay, so each of T1, T2 and T3 must
+    // be from 1 to 16 cycles
+    constexpr bool cycles_valid() const {
+        return t1>=1 and t1<=16 and t2>=1 and t2<=16 and t3>=1 and t3<=16;
+    }
+
+    // The nominal times are inside the datasheet windows by at least margin_ns
+    constexpr bool within_window(uint32_t margin_ns) const {
+        return t0h_ns() >= window.t0h_min + margin_ns and t0h_ns() + margin_ns <= window.t0h_max
+            and t1h_ns() >= window.t1h_min + margin_ns and t1h_ns() + margin_ns <= window.t1h_max
+            and t0l_ns() >= window.t0l_min + margin_ns and t0l_ns() + margin_ns <= window.t0l_max
+            and t1l_ns() >= window.t1l_min + margin_ns and t1l_ns() + margin_ns <= window.t1l_max;
+    }
+
+    // The latch is at least the datasheet reset time
+    constexpr bool latch_valid() const { return latch_us >= window.latch_min_us; }
+};
+
+enum LEDChip {
+    CHIP_WS2812,
+    CHIP_WS2812B,
+    CHIP_SK6812,
+    CHIP_WS2811_400K,
+    CHIP_WS2815,
+    CHIP_APA102,
+    CHIP_SK9822,
+    NUM_CHIPS // MUST BE LAST ITEM IN LIST
+};
+
+// WS2812 keeps the broad-compatibility timing of the ws2812 program, and its
+// latch time covers the WS2812B clones sold under that name. The others are
+// run as fast as their windows allow. WS2812B uses the classic +/-150 ns
+// datasheet; the later V5 revision wants longer lows, like WS2815, and a
+// reset of 280 us, which the latch of every WS2812B profile must cover. The
+// clocked chips are good for 20 MHz or more on short chains, but the clock
+// degrades as it is regenerated by each LED, so long chains need it slower.
+static constexpr ChipProfile CHIP_PROFILES[NUM_CHIPS] = {
+    { "WS2812",      3, 3, 4,  800000, 300,
+        {  200,  500,  550,  850,  650,  950,  450,  750, 280 } },
+    { "WS2812B",     3, 4, 4,  900000, 300,
+        {  250,  550,  650,  950,  700, 1000,  300,  600, 280 } },
+    { "SK6812",      2, 2, 3,  850000, 100,
+        {  150,  450,  450,  750,  750, 1050,  450,  750,  80 } },
+    { "WS2811-400k", 5, 7, 13, 400000,  60,
+        {  350,  650, 1050, 1350, 1850, 2150, 1150, 1450,  50 } },
+    { "WS2815",      3, 3, 6,  800000, 300,
+        {  220,  380,  580, 1000,  580, 1000,  580, 1000, 280 } },
+    { "APA102",      0, 0, 0, 10000000,  0, { }, true },
+    { "SK9822",      0, 0, 0, 10000000,  0, { }, true },
+};
+
+// The margin covers the jitter of the fractional clock divider, which can
+// stretch or shorten any phase by one system clock cycle
+static constexpr uint32_t CHIP_TIMING_MARGIN_NS = 25;
+
+constexpr bool chip_profiles_valid() {
+    for(const auto& profile : CHIP_PROFILES) {
+        if(not profile.clocked and (not profile.cycles_valid()
+                or not profile.within_window(CHIP_TIMING_MARGIN_NS)
+                or not profile.latch_valid())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(chip_profiles_valid(), "Chip profile timing outside datasheet window or latch too short");
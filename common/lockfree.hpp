@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+
+// Lock-free channels between the two cores (or two threads on the host).
+// They only use atomic loads and stores, which are single instructions
+// (with barriers) on the M0+ and M33, so neither side ever disables
+// interrupts, takes a lock or waits for the other one.
+
+// Queue with a single producer and a single consumer, holding up to N-1
+// elements (N must be a power of two). The producer owns head_ and the
+// consumer tail_, each only reading the other's index.
+template<typename T, unsigned N> class SPSCQueue {
+public:
+    static_assert(N >= 2 and (N & (N-1)) == 0, "SPSCQueue size must be a power of two");
+
+    // Producer : returns false if the queue is full
+    bool push(const T& value) {
+        unsigned head = head_.load(std::memory_order_relaxed);
+        unsigned next = (head + 1) & (N-1);
+        if(next == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        buffer_[head] = value;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer : returns false if the queue is empty
+    bool pop(T& value) {
+        unsigned tail = tail_.load(std::memory_order_relaxed);
+        if(tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = buffer_[tail];
+        tail_.store((tail + 1) & (N-1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+private:
+    T buffer_[N];
+    std::atomic<unsigned> head_ { 0 };
+    std::atomic<unsigned> tail_ { 0 };
+};
+
+// Value with a single writer and any number of readers, which always see a
+// complete (consistent) copy. The sequence number is odd while a write is in
+// progress, and readers retry if it was odd or changed while they copied.
+// The value is stored as atomic words so the copies are not data races.
+template<typename T> class SeqLock {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock value must be trivially copyable");
+
+    SeqLock() {
+        T value = { };
+        store_words(value);
+    }
+
+    // Writer
+    void write(const T& value) {
+        uint32_t seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        store_words(value);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Readers
+    T read() const {
+        T value;
+        uint32_t seq = 0;
+        read_if_newer(value, seq);
+        return value;
+    }
+
+    // Copy the value if it has been written since sequence number seq was
+    // returned (start with seq=0), updating seq and returning true if so
+    bool read_if_newer(T& value, uint32_t& seq) const {
+        uint32_t seq0;
+        uint32_t seq1;
+        do {
+            seq0 = seq_.load(std::memory_order_acquire);
+            if(seq0 == seq and seq != 0) {
+                return false;
+            }
+            if(seq0 & 1) {
+                continue;
+            }
+            load_words(value);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seq1 = seq_.load(std::memory_order_relaxed);
+        } while((seq0 & 1) or seq0 != seq1);
+        bool newer = (seq0 != seq);
+        seq = seq0;
+        return newer;
+    }
+
+private:
+    static constexpr unsigned NWORD = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    void store_words(const T& value) {
+        uint32_t words[NWORD] = { };
+        std::memcpy(words, &value, sizeof(T));
+        for(unsigned i=0; i<NWORD; i++) {
+            data_[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    void load_words(T& value) const {
+        uint32_t words[NWORD];
+        for(unsigned i=0; i<NWORD; i++) {
+            words[i] = data_[i].load(std::memory_order_relaxed);
+        }
+        std::memcpy(&value, words, sizeof(T));
+    }
+
+    std::atomic<uint32_t> seq_ { 0 };
+    std::atomic<uint32_t> data_[NWORD];
+};
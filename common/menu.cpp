@@ -21,6 +21,7 @@ namespace {
 
 int Menu::screen_w_ = Menu::default_screen_width();
 int Menu::screen_h_ = Menu::default_screen_height();
+volatile uint32_t Menu::idle_time_us_ = 0;
 
 RowAndColumnGetter::~RowAndColumnGetter()
 {
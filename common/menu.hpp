@@ -38,6 +38,10 @@ public:
     int screen_height() const { return screen_h_; }
     static void set_screen_size(int h, int w) { screen_h_ = h; screen_w_ = w; }
 
+    // Time the event loops (of all menus) have spent waiting for input, used
+    // to measure the load of the core running them. Wraps after ~71 minutes.
+    static uint32_t idle_time_us() { return idle_time_us_; }
+
     static int puts_raw_nonl(const char* s);
     static int puts_raw_nonl(const char* s, size_t maxchars, bool fill = false);
     static int puts_raw_nonl(const std::string& s);
@@ -129,6 +133,7 @@ protected:
     uint64_t timer_interval_us_   = default_timer_interval_us();
     static int screen_w_;
     static int screen_h_;
+    static volatile uint32_t idle_time_us_;
 
 private:
     static int decode_partial_escape_sequence(int key, std::string& escape_sequence, 
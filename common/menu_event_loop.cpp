@@ -51,7 +51,9 @@ int Menu::event_loop(bool enable_escape_sequences, bool enable_reboot)
                 }
             }
             was_connected = true;
+            uint32_t wait_start_us = time_us_32();
             int key = getchar_timeout_us(timer_delay);
+            idle_time_us_ += time_us_32() - wait_start_us;
             absolute_time_t key_time = get_absolute_time();
             if(absolute_time_diff_us(last_key_time, key_time)>multi_keypress_timeout) {
                 last_key = -1;
@@ -193,7 +195,9 @@ int Menu::event_loop(bool enable_escape_sequences, bool enable_reboot)
                 last_key = -1;
                 key_count = 0;
             }
+            uint32_t wait_start_us = time_us_32();
             sleep_us(1000);
+            idle_time_us_ += time_us_32() - wait_start_us;
         }
 
         if(absolute_time_diff_us(get_absolute_time(), next_timer) <= 0) {
@@ -0,0 +1,209 @@
+#include <pico/time.h>
+#include <pico/flash.h>
+#include <pico/multicore.h>
+#include <hardware/sync.h>
+
+#include "build_date.hpp"
+#include "output_engine.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+
+    // Engine run by core 1, which is launched without an argument
+    static OutputEngine* core1_engine = nullptr;
+}
+
+FrameGenerator::~FrameGenerator()
+{
+    // nothing to see here
+}
+
+void FrameGenerator::output_starting(SerialPIO& pio)
+{
+    // nothing to see here
+}
+
+void FrameGenerator::process_command(SerialPIO& pio, int command)
+{
+    // nothing to see here
+}
+
+void FrameGenerator::output_finishing(SerialPIO& pio)
+{
+    // nothing to see here
+}
+
+OutputEngine::OutputEngine(SerialPIO& pio): pio_(pio)
+{
+    // nothing to see here
+}
+
+OutputEngine::~OutputEngine()
+{
+    if(running()) {
+        stop();
+    }
+}
+
+void OutputEngine::launch()
+{
+    hard_assert(!launched_ and core1_engine == nullptr);
+    core1_engine = this;
+    launched_ = true;
+    multicore_launch_core1(&OutputEngine::core1_entry);
+}
+
+void OutputEngine::start_with_period(FrameGenerator* generator, uint32_t frame_period)
+{
+    hard_assert(launched_ and !running());
+    generator_ = generator;
+    frame_period_ = frame_period;
+    frame_count_ = 0;
+    missed_frame_count_ = 0;
+    max_late_us_ = 0;
+    __dmb();
+    command_ = CMD_START;
+    while(command_ != CMD_NONE) {
+        tight_loop_contents();
+    }
+}
+
+void OutputEngine::stop()
+{
+    hard_assert(running());
+    command_ = CMD_STOP;
+    // Wake core 1 if it is waiting for the next frame
+    __sev();
+    while(command_ != CMD_NONE) {
+        tight_loop_contents();
+    }
+}
+
+void OutputEngine::start_stats_window(uint32_t now_us)
+{
+    stats_.reset();
+    window_start_us_ = now_us;
+    window_core0_idle_us_ = Menu::idle_time_us();
+    uint32_t transmit_us;
+    uint32_t latch_us;
+    timed_frame_count_ = pio_.frame_timing(transmit_us, latch_us);
+    skipped_frame_count_ = pio_.skipped_frame_count();
+    dithered_frame_count_ = pio_.dithered_frame_count();
+    limited_frame_count_ = pio_.limited_frame_count();
+}
+
+void OutputEngine::record_frame_stats(uint32_t idle_us, uint32_t render_us, uint32_t nmissed)
+{
+    ++stats_.nframe;
+    stats_.nmissed += nmissed;
+    stats_.idle.add(idle_us);
+    stats_.render.add(render_us);
+
+    // Frames are sent asynchronously, by the time this one has been queued
+    // the previous one has normally been latched
+    uint32_t transmit_us;
+    uint32_t latch_us;
+    uint32_t timed_frame_count = pio_.frame_timing(transmit_us, latch_us);
+    if(timed_frame_count != timed_frame_count_) {
+        timed_frame_count_ = timed_frame_count;
+        stats_.transmit.add(transmit_us);
+        stats_.latch.add(latch_us);
+    }
+
+    stats_.nskipped = pio_.skipped_frame_count() - skipped_frame_count_;
+    stats_.ndithered = pio_.dithered_frame_count() - dithered_frame_count_;
+    if(pio_.power_limiter().enabled()) {
+        uint32_t current_ma = pio_.current_ma();
+        stats_.current_ma_sum += current_ma;
+        stats_.current_ma_max = std::max(stats_.current_ma_max, current_ma);
+        stats_.nlimited = pio_.limited_frame_count() - limited_frame_count_;
+    }
+
+    uint32_t now_us = time_us_32();
+    if(now_us - window_start_us_ >= STATS_WINDOW_US) {
+        stats_.window_us = now_us - window_start_us_;
+        stats_.core0_idle_us = Menu::idle_time_us() - window_core0_idle_us_;
+        pio_.publish_frame_stats(stats_);
+        start_stats_window(now_us);
+    }
+}
+
+void OutputEngine::core1_entry()
+{
+    core1_engine->core1_main();
+}
+
+void OutputEngine::core1_main()
+{
+    // Allow core 0 to write the saved state to flash while we are running
+    flash_safe_execute_core_init();
+    while(true) {
+        while(command_ != CMD_START) {
+            tight_loop_contents();
+        }
+        __dmb();
+        run_generator();
+    }
+}
+
+void OutputEngine::run_generator()
+{
+    FrameGenerator* generator = generator_;
+    int command;
+    // Commands left over for a previous generator are dropped
+    while(commands_.pop(command));
+    pio_.activate_program();
+    generator->output_starting(pio_);
+
+    // The first frame is due as soon as the scheduler is started
+    uint32_t tick = 0;
+    scheduler_.start(frame_period_);
+    scheduler_.take_frame();
+    uint32_t t0 = time_us_32();
+    start_stats_window(t0);
+    generator->generate_frame(pio_, tick++);
+    record_frame_stats(0, time_us_32() - t0, 0);
+    frame_count_ = tick;
+    command_ = CMD_NONE;
+
+    while(true) {
+        // Frames fall on the grid of the scheduler alarm, if we fall behind
+        // the deadlines that have passed are skipped rather than sending a
+        // burst of frames to catch up. When dithering, the chain is refreshed
+        // whenever it has latched the last frame, which is not idle time.
+        uint32_t wait_start_us = time_us_32();
+        uint32_t dither_us = 0;
+        while(!scheduler_.frame_due() and command_ != CMD_STOP) {
+            if(pio_.dithered_frame_ready()) {
+                uint32_t dither_start_us = time_us_32();
+                pio_.send_dithered_frame();
+                dither_us += time_us_32() - dither_start_us;
+            } else {
+                __wfe();
+            }
+        }
+        if(command_ == CMD_STOP) {
+            break;
+        }
+        uint32_t nmissed = scheduler_.missed_count();
+        scheduler_.take_frame();
+        t0 = time_us_32();
+        while(commands_.pop(command)) {
+            generator->process_command(pio_, command);
+        }
+        generator->generate_frame(pio_, tick++);
+        record_frame_stats(t0 - wait_start_us - dither_us, time_us_32() - t0,
+            scheduler_.missed_count() - nmissed);
+        frame_count_ = tick;
+        missed_frame_count_ = scheduler_.missed_count();
+        max_late_us_ = scheduler_.max_late_us();
+    }
+
+    scheduler_.stop();
+    generator->output_finishing(pio_);
+    pio_.put_pixel_run_dma(0, pio_.nled());
+    pio_.deactivate_program();
+    generator_ = nullptr;
+    __dmb();
+    command_ = CMD_NONE;
+}
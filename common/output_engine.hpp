@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+
+#include "pico/time.h"
+
+#include "color_led.hpp"
+#include "lockfree.hpp"
+#include "frame_scheduler.hpp"
+
+// Effect run by the OutputEngine. All of its functions are called on core 1,
+// so it owns the SerialPIO and its render state there, and should only take
+// its parameters from core 0 through SharedParams.
+class FrameGenerator {
+public:
+    virtual ~FrameGenerator();
+    // Called after the program has been activated, before the first frame
+    virtual void output_starting(SerialPIO& pio);
+    // Handle a command sent from core 0 with OutputEngine::send_command,
+    // called before the frame is generated
+    virtual void process_command(SerialPIO& pio, int command);
+    // Render and send frame number tick (counting from zero)
+    virtual void generate_frame(SerialPIO& pio, uint32_t tick) = 0;
+    // Called after the last frame, before the chain is blanked
+    virtual void output_finishing(SerialPIO& pio);
+};
+
+// Copy of the parameters of an effect, published by its menu on core 0 and
+// fetched by its generator on core 1 at the start of each frame, which always
+// gets a consistent set without either side blocking the other.
+template<typename T> class SharedParams {
+public:
+    void publish(const T& params) { params_.write(params); }
+
+    // Copy the parameters if they have been published since the last fetch,
+    // returning true if they were
+    bool fetch(T& params) { return params_.read_if_newer(params, fetched_seq_); }
+
+private:
+    SeqLock<T> params_;
+    uint32_t fetched_seq_ = 0;
+};
+
+// Run the frame generation and transmission of the active effect on core 1,
+// so that the timing of the frames does not depend on USB, the terminal or
+// the redrawing of the menus on core 0. The SerialPIO is activated on core 1,
+// so its DMA and latch interrupts are also handled there, as is the alarm of
+// the FrameScheduler that sets the deadline of each frame. The timing of the
+// frames is gathered into FrameStats, published through the SerialPIO.
+class OutputEngine {
+public:
+    OutputEngine(SerialPIO& pio);
+    ~OutputEngine();
+
+    // Start core 1, which waits for a generator to run. Called once.
+    void launch();
+
+    // Called from core 0 : start running the generator, one frame every
+    // frame_interval_us (or at rate_mhz frames per 1000 seconds), returning
+    // once the first frame has been sent. The chain is blanked and the
+    // program deactivated by stop().
+    void start(FrameGenerator* generator, uint32_t frame_interval_us) {
+        start_with_period(generator, FrameScheduler::period_from_interval_us(frame_interval_us));
+    }
+    void start_at_rate(FrameGenerator* generator, uint32_t rate_mhz) {
+        start_with_period(generator, FrameScheduler::period_from_rate_mhz(rate_mhz));
+    }
+    void stop();
+
+    // Called from core 0 : queue a command for the running generator, which
+    // processes it before its next frame. Returns false if the queue is full.
+    bool send_command(int command) { return commands_.push(command); }
+
+    bool running() const { return generator_ != nullptr; }
+    uint32_t frame_count() const { return frame_count_; }
+    // Frames skipped because the previous ones were not finished in time,
+    // and the longest a frame has been started after its deadline
+    uint32_t missed_frame_count() const { return missed_frame_count_; }
+    uint32_t max_late_us() const { return max_late_us_; }
+    SerialPIO& pio() { return pio_; }
+
+private:
+    OutputEngine(const OutputEngine&) = delete;
+    OutputEngine& operator=(const OutputEngine&) = delete;
+
+    enum Command {
+        CMD_NONE,
+        CMD_START,
+        CMD_STOP
+    };
+
+    void start_with_period(FrameGenerator* generator, uint32_t frame_period);
+
+    static constexpr uint32_t STATS_WINDOW_US = 1000000;
+
+    static void core1_entry();
+    void core1_main();
+    void run_generator();
+    void start_stats_window(uint32_t now_us);
+    void record_frame_stats(uint32_t idle_us, uint32_t render_us, uint32_t nmissed);
+
+    SerialPIO& pio_;
+    bool launched_ = false;
+
+    // Written by core 0 and acknowledged by core 1 resetting it to CMD_NONE
+    volatile int command_ = CMD_NONE;
+    FrameGenerator* volatile generator_ = nullptr;
+    volatile uint32_t frame_period_ = 0;
+    volatile uint32_t frame_count_ = 0;
+    volatile uint32_t missed_frame_count_ = 0;
+    volatile uint32_t max_late_us_ = 0;
+
+    SPSCQueue<int, 16> commands_;
+    FrameScheduler scheduler_;
+
+    // Statistics of the current window, only used by core 1
+    FrameStats stats_;
+    uint32_t window_start_us_ = 0;
+    uint32_t window_core0_idle_us_ = 0;
+    uint32_t timed_frame_count_ = 0;
+    uint32_t skipped_frame_count_ = 0;
+    uint32_t dithered_frame_count_ = 0;
+    uint32_t limited_frame_count_ = 0;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+// Pixel codes as the WS2812 state machines take them, left aligned : green,
+// red and blue in the upper three bytes (grbz), and the white level of RGBW
+// (SK6812) pixels in the low byte (grbw).
+
+inline uint32_t rgb_to_grbz(uint32_t r, uint32_t g, uint32_t b) {
+    return ((r&0xFF) << 16) | ((g&0xFF) << 24) | ((b&0xFF) << 8);
+}
+
+inline void grbz_to_rgb(uint32_t grbz, uint32_t &r, uint32_t &g, uint32_t &b) {
+    b = (grbz>>8) & 0xFF;
+    r = (grbz>>16) & 0xFF;
+    g = (grbz>>24) & 0xFF;
+}
+
+inline uint32_t rgbw_to_grbw(uint32_t r, uint32_t g, uint32_t b, uint32_t w) {
+    return ((r&0xFF) << 16) | ((g&0xFF) << 24) | ((b&0xFF) << 8) | (w&0xFF);
+}
+
+// Move the common part of the three colors into the white channel of an
+// RGBW (SK6812) pixel. The white level is subtracted from each color byte,
+// which can not borrow since none is below it, and placed in the low byte.
+inline uint32_t grbz_to_grbw(uint32_t grbz) {
+    uint32_t w = std::min(std::min(grbz>>24, (grbz>>16) & 0xFF), (grbz>>8) & 0xFF);
+    return (grbz & 0xFFFFFF00) - w*0x01010100 + w;
+}
@@ -0,0 +1,43 @@
+#include "build_date.hpp"
+#include "post_process.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+}
+
+void PostProcessor::apply(uint32_t* pixel_codes, unsigned npixel) const
+{
+    for(unsigned i=0; i<npixel; i++) {
+        pixel_codes[i] = apply(pixel_codes[i]);
+    }
+}
+
+void PostProcessor::dither(uint32_t* pixel_codes, const uint16_t* level, uint8_t* error,
+    unsigned npixel)
+{
+    for(unsigned i=0; i<npixel; i++, level+=3, error+=3) {
+        // The levels are at most 255*256, so the sums never exceed 16 bits
+        uint32_t g = level[0] + error[0];
+        uint32_t r = level[1] + error[1];
+        uint32_t b = level[2] + error[2];
+        error[0] = g;
+        error[1] = r;
+        error[2] = b;
+        pixel_codes[i] = ((g >> 8) << 24) | ((r >> 8) << 16) | (b & 0xFF00);
+    }
+}
+
+void PostProcessor::update_lut()
+{
+    uint64_t brightness = brightness_;
+    for(uint32_t v=0; v<256; v++) {
+        if(gamma_) {
+            lut_[v] = (gamma_table::GAMMA16.value[v] * brightness + 32767) / 65535;
+            lut16_[v] = (gamma_table::GAMMA16.value[v] * brightness * 256 + 32767) / 65535;
+        } else {
+            lut_[v] = (v * brightness + 127) / 255;
+            lut16_[v] = (v * brightness * 256 + 127) / 255;
+        }
+    }
+    identity_ = !gamma_ and brightness_ == MAX_BRIGHTNESS;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+// Gamma correction for 8-bit color levels : the linear intensity of level v
+// is (v/255)^2.2, given here over 16 bits (0-65535) and computed at compile
+// time. The exponent 2.2 = 11/5 is reached with a fifth root by Newton's
+// method, since std::pow is not constexpr.
+namespace gamma_table {
+    constexpr double fifth_root(double x) {
+        double y = 1.0;
+        for(int i=0; i<40; i++) {
+            double y4 = y*y*y*y;
+            y -= (y - x/y4) / 5.0;
+        }
+        return y;
+    }
+
+    constexpr uint16_t gamma16(int v) {
+        if(v <= 0) {
+            return 0;
+        }
+        double r = fifth_root(v / 255.0);
+        double r11 = r*r*r*r*r*r*r*r*r*r*r;
+        return uint16_t(r11 * 65535.0 + 0.5);
+    }
+
+    struct Table {
+        uint16_t value[256];
+    };
+
+    constexpr Table make_gamma16() {
+        Table t = { };
+        for(int v=0; v<256; v++) {
+            t.value[v] = gamma16(v);
+        }
+        return t;
+    }
+
+    static constexpr Table GAMMA16 = make_gamma16();
+    static_assert(GAMMA16.value[0] == 0 and GAMMA16.value[255] == 65535, "Gamma table end points");
+    static_assert(GAMMA16.value[128] > 14300 and GAMMA16.value[128] < 14500, "Gamma table mid point");
+}
+
+// Correction applied to each pixel as it is sent : gamma (optional) and a
+// global brightness, folded together into a table of 256 output levels that
+// is rebuilt when either is changed, so each pixel costs three lookups. A
+// second table gives the levels with 8 more bits (in 1/256 of an output
+// level), which temporal dithering spreads over successive frames. Gamma is
+// off by default, so that the codes of existing effects are sent unchanged.
+class PostProcessor {
+public:
+    static constexpr int MAX_BRIGHTNESS = 255;
+
+    PostProcessor() { update_lut(); }
+
+    bool gamma() const { return gamma_; }
+    int brightness() const { return brightness_; }
+    void set_gamma(bool gamma) { gamma_ = gamma; update_lut(); }
+    void set_brightness(int brightness) { brightness_ = brightness; update_lut(); }
+
+    // The correction does nothing (no gamma and full brightness)
+    bool identity() const { return identity_; }
+
+    inline uint32_t apply(uint32_t grbz) const {
+        return (uint32_t(lut_[grbz >> 24]) << 24)
+            | (uint32_t(lut_[(grbz >> 16) & 0xFF]) << 16)
+            | (uint32_t(lut_[(grbz >> 8) & 0xFF]) << 8);
+    }
+    void apply(uint32_t* pixel_codes, unsigned npixel) const;
+
+    // Levels of green, red and blue of a grbz code, from 0 to 255*256
+    inline void expand(uint32_t grbz, uint16_t* grb) const {
+        grb[0] = lut16_[grbz >> 24];
+        grb[1] = lut16_[(grbz >> 16) & 0xFF];
+        grb[2] = lut16_[(grbz >> 8) & 0xFF];
+    }
+
+    // One frame of temporal dithering : each channel is sent as its level
+    // (three per pixel, from expand) plus the error carried from the frame
+    // before, rounded down to 8 bits, and the part rounded off is carried on
+    static void dither(uint32_t* pixel_codes, const uint16_t* level, uint8_t* error,
+        unsigned npixel);
+
+private:
+    void update_lut();
+
+    bool gamma_ = false;
+    int brightness_ = MAX_BRIGHTNESS;
+    bool identity_ = false;
+    uint8_t lut_[256];
+    uint16_t lut16_[256];
+};
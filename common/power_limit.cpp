@@ -0,0 +1,54 @@
+#include "build_date.hpp"
+#include "power_limit.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+}
+
+uint64_t PowerLimiter::dynamic_ua(const LevelSums& sums) const
+{
+    uint64_t level_ua = 0;
+    for(int ichan=0; ichan<4; ichan++) {
+        level_ua += uint64_t(sums.level[ichan]) * profile_.full_ua[ichan];
+    }
+    return level_ua / 255;
+}
+
+uint32_t PowerLimiter::current_ma(const LevelSums& sums, unsigned nled, uint32_t factor) const
+{
+    uint64_t ua = uint64_t(profile_.idle_ua) * nled + ((dynamic_ua(sums) * factor) >> 16);
+    return uint32_t((ua + 500) / 1000);
+}
+
+uint32_t PowerLimiter::scale_factor(const LevelSums& sums, unsigned nled) const
+{
+    int64_t available_ua = int64_t(budget_ma_) * 1000 - int64_t(profile_.idle_ua) * nled;
+    uint64_t ua = dynamic_ua(sums);
+    if(available_ua < 0) {
+        return 0;
+    }
+    if(ua <= uint64_t(available_ua)) {
+        return FACTOR_ONE;
+    }
+    return uint32_t((uint64_t(available_ua) << 16) / ua);
+}
+
+void PowerLimiter::scale(uint32_t* codes, unsigned ncode, uint32_t factor)
+{
+    // Only frames over the budget get here, so the table is built each time
+    uint8_t lut[256];
+    for(uint32_t v=0; v<256; v++) {
+        lut[v] = (v * factor) >> 16;
+    }
+    for(unsigned i=0; i<ncode; i++) {
+        uint32_t code = codes[i];
+        codes[i] = (uint32_t(lut[code >> 24]) << 24) | (uint32_t(lut[(code >> 16) & 0xFF]) << 16)
+            | (uint32_t(lut[(code >> 8) & 0xFF]) << 8) | lut[code & 0xFF];
+    }
+}
+
+uint32_t PowerLimiter::scale(uint32_t code, uint32_t factor)
+{
+    return ((((code >> 24) * factor) >> 16) << 24) | (((((code >> 16) & 0xFF) * factor) >> 16) << 16)
+        | (((((code >> 8) & 0xFF) * factor) >> 16) << 8) | (((code & 0xFF) * factor) >> 16);
+}
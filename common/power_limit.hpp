@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+// Typical current drawn by one LED : when dark, and by each channel (green,
+// red, blue, white) at full level, in uA. These are datasheet values, strips
+// differ, so the budget should leave some margin.
+struct PowerProfile {
+    uint32_t idle_ua;
+    uint32_t full_ua[4];
+};
+
+static constexpr PowerProfile WS2812_POWER = { 600, { 12000, 12000, 12000, 0 } };
+static constexpr PowerProfile SK6812_RGBW_POWER = { 1000, { 12000, 12000, 12000, 18000 } };
+static constexpr PowerProfile APA102_POWER = { 800, { 20000, 20000, 20000, 0 } };
+
+// Estimate of the current drawn by a frame from the sums of its channel
+// levels, and the factor by which its levels must be scaled to keep it within
+// the budget. The sums are gathered by whoever makes the final pass over the
+// pixel codes (grbz or grbw), so the estimate costs a few additions a pixel.
+class PowerLimiter {
+public:
+    static constexpr uint32_t FACTOR_ONE = 1 << 16;
+
+    struct LevelSums {
+        uint32_t level[4]; // green, red, blue, white
+        inline void add(uint32_t code) {
+            level[0] += code >> 24;
+            level[1] += (code >> 16) & 0xFF;
+            level[2] += (code >> 8) & 0xFF;
+            level[3] += code & 0xFF;
+        }
+        inline void add(uint32_t code, unsigned npixel) {
+            level[0] += (code >> 24) * npixel;
+            level[1] += ((code >> 16) & 0xFF) * npixel;
+            level[2] += ((code >> 8) & 0xFF) * npixel;
+            level[3] += (code & 0xFF) * npixel;
+        }
+    };
+
+    int budget_ma() const { return budget_ma_; }
+    void set_budget_ma(int budget_ma) { budget_ma_ = budget_ma; }
+    bool enabled() const { return budget_ma_ > 0; }
+    void set_profile(const PowerProfile& profile) { profile_ = profile; }
+
+    // Current drawn by nled LEDs whose levels add up to sums, with the levels
+    // scaled by factor (in units of FACTOR_ONE)
+    uint32_t current_ma(const LevelSums& sums, unsigned nled, uint32_t factor = FACTOR_ONE) const;
+
+    // Factor by which to scale the levels to keep within the budget, which is
+    // FACTOR_ONE if they already are
+    uint32_t scale_factor(const LevelSums& sums, unsigned nled) const;
+
+    // Scale each byte of the codes (or of one code) by factor
+    static void scale(uint32_t* codes, unsigned ncode, uint32_t factor);
+    static uint32_t scale(uint32_t code, uint32_t factor);
+
+private:
+    uint64_t dynamic_ua(const LevelSums& sums) const;
+
+    int budget_ma_ = 0;
+    PowerProfile profile_ = WS2812_POWER;
+};
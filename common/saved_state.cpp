@@ -139,6 +139,12 @@ bool SavedStateManager::load_state(bool debug)
                 found = true;
                 loaded = supplier->set_saved_state(s);
             }
+            else if(supplier->get_supplier_id() == supplier_id
+                and supplier->get_version() > version)
+            {
+                found = true;
+                loaded = supplier->set_old_saved_state(version, s);
+            }
         }
         if(debug) {
             char code[5] = {0,0,0,0,0};
@@ -8,6 +8,8 @@ public:
     virtual ~SavedStateSupplierConsumer();
     virtual std::vector<int32_t> get_saved_state() = 0;
     virtual bool set_saved_state(const std::vector<int32_t>& state) = 0;
+    // Called with a state saved by an older version, return false to discard it
+    virtual bool set_old_saved_state(int32_t version, const std::vector<int32_t>& state) { return false; }
     virtual int32_t get_version() = 0;
     virtual int32_t get_supplier_id() = 0;
 };
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "bi_color_flashes.hpp"
+#include "pixel_code.hpp"
+
+// Cost of the flashes on a 2048 LED chain, per frame, for a few flash
+// probabilities and the decay curves : the flash list, which visits only the
+// live flashes, against the scan of every LED that halved a brightness per
+// LED each frame and then blended the whole chain.
+
+namespace {
+    static constexpr int NLED = 2048;
+    static constexpr int NFRAME = 5000;
+
+    double list_us(int flash_prob, int decay, double& mean_nflash)
+    {
+        BiColorFlashes flashes;
+        flashes.set_probability(flash_prob, NLED);
+        std::vector<uint32_t> frame(NLED, 0x10101000);
+        double ns = 0;
+        long sum_nflash = 0;
+        for(int iframe=0; iframe<NFRAME; iframe++) {
+            auto t0 = std::chrono::steady_clock::now();
+            flashes.generate(decay);
+            flashes.apply(frame.data(), decay, 255, 255, 255);
+            asm volatile("" : : "r"(frame.data()) : "memory");
+            auto t1 = std::chrono::steady_clock::now();
+            ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+            sum_nflash += flashes.nflash();
+        }
+        mean_nflash = double(sum_nflash) / NFRAME;
+        return ns / NFRAME / 1000;
+    }
+
+    double scan_us(uint32_t non_flash_prob)
+    {
+        std::minstd_rand rng(123);
+        std::vector<uint8_t> flash_value(NLED, 0);
+        std::vector<uint32_t> frame(NLED, 0x10101000);
+        double ns = 0;
+        for(int iframe=0; iframe<NFRAME; iframe++) {
+            auto t0 = std::chrono::steady_clock::now();
+            for(int i=0; i<NLED; i++) {
+                flash_value[i] >>= 1;
+            }
+            uint32_t x = rng();
+            for(int nflash=0; nflash<NLED and x<non_flash_prob; ++nflash) {
+                flash_value[rng() % NLED] = 255;
+                x = rng();
+            }
+            for(int iled=0; iled<NLED; iled++) {
+                uint32_t w = flash_value[iled];
+                if(w > 0) {
+                    uint32_t r,g,b;
+                    grbz_to_rgb(frame[iled], r, g, b);
+                    frame[iled] = rgb_to_grbz(std::max(r, w), std::max(g, w), std::max(b, w));
+                }
+            }
+            asm volatile("" : : "r"(frame.data()) : "memory");
+            auto t1 = std::chrono::steady_clock::now();
+            ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        }
+        return ns / NFRAME / 1000;
+    }
+}
+
+int main()
+{
+    printf("%d LEDs, mean of %d frames\n", NLED, NFRAME);
+    printf("prob  decay   flashes  list [us]  scan [us]\n");
+    for(int flash_prob : { 0, 1, 4, 16, 256 }) {
+        BiColorFlashes flashes;
+        flashes.set_probability(flash_prob, NLED);
+        double scan = scan_us(flashes.non_flash_prob());
+        for(int decay=0; decay<BiColorFlashes::NUM_DECAY_CURVES; decay++) {
+            double mean_nflash;
+            double list = list_us(flash_prob, decay, mean_nflash);
+            printf("%4d  %-6s  %7.1f  %9.2f  %9.2f\n", flash_prob, BiColorFlashes::decay_curve_name(decay),
+                mean_nflash, list, scan);
+        }
+    }
+    return 0;
+}
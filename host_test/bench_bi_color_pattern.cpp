@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "bi_color_pattern.hpp"
+
+// Cost of filling a 2048 LED chain with the bi color pattern, for a few
+// periods : one color_code call per LED, as the menu used to, against the
+// incremental render_period it uses now. Then the cost of a frame when a
+// power of two period scrolls from the ring buffer : the period is rendered
+// only when the pattern changes, but blended each frame the phase moves by a
+// fraction of an LED, against rendering the chain. The ring is also
+// corrected each time on the device, at the per pixel cost of apply in
+// bench_post_process.
+
+namespace {
+    static constexpr int NLED = 2048;
+    static constexpr int NREP = 500;
+
+    // Best time of NREP runs of fn, in ns
+    template<typename Fn> double best_ns(Fn fn)
+    {
+        double best = 1e30;
+        for(int irep=0; irep<NREP; irep++) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+        return best;
+    }
+}
+
+int main()
+{
+    std::vector<uint32_t> codes(NLED);
+    BiColorPattern pattern;
+    pattern.set_colors(255, 40, 0, 0, 80, 255);
+
+    printf("%d LEDs, best of %d\n", NLED, NREP);
+    printf("period   color_code [us]  render_period [us]  speedup\n");
+    for(int period : { 4, 16, 64, 256, 2048 }) {
+        pattern.set_geometry(period, 64, 32);
+        pattern.set_phase(12345);
+        double ns_code = best_ns([&]() {
+            for(int iled=0; iled<NLED; iled++) {
+                codes[iled] = pattern.color_code(iled);
+            }
+            asm volatile("" : : "r"(codes.data()) : "memory");
+        });
+        double ns_render = best_ns([&]() {
+            pattern.render_period(codes.data(), 1, NLED);
+            asm volatile("" : : "r"(codes.data()) : "memory");
+        });
+        printf("%6d  %15.1f  %18.1f  %7.1fx\n", period, ns_code / 1000, ns_render / 1000,
+            ns_code / ns_render);
+    }
+
+    printf("\nscrolling, per frame\n");
+    printf("period  render chain [us]  blend period [us]\n");
+    std::vector<uint32_t> period(1024);
+    std::vector<uint32_t> ring(1024);
+    for(int p : { 4, 16, 64, 256, 1024 }) {
+        pattern.set_geometry(p, 64, 32);
+        pattern.set_phase(12345);
+        pattern.render_period(period.data(), 1, p);
+        double ns_render = best_ns([&]() {
+            pattern.render_period(codes.data(), 1, NLED);
+            asm volatile("" : : "r"(codes.data()) : "memory");
+        });
+        int blend = 0;
+        double ns_blend = best_ns([&]() {
+            BiColorPattern::blend_period(period.data(), ring.data(), p, ++blend & 0xFF);
+            asm volatile("" : : "r"(ring.data()) : "memory");
+        });
+        printf("%6d  %17.1f  %17.1f\n", p, ns_render / 1000, ns_blend / 1000);
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "bit_transpose.hpp"
+#include "bit_transpose_reference.hpp"
+
+// Strip pixels per second transposed by grbz_to_bit_slots and by the one bit
+// at a time reference, for 2048 pixels and 1 to 32 strips
+
+namespace {
+    template<typename Fn> double strip_pixels_per_second(Fn fn, int nstrip, int nled)
+    {
+        constexpr int NREP = 200;
+        auto t0 = std::chrono::steady_clock::now();
+        for(int irep=0; irep<NREP; irep++) {
+            fn();
+        }
+        double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return double(NREP) * nled * nstrip / dt;
+    }
+}
+
+int main()
+{
+    constexpr int NLED = 2048;
+    std::mt19937 rng(1);
+    printf("nstrip   reference (Mpix/s)   grbz_to_bit_slots (Mpix/s)   speedup\n");
+    for(int nstrip : { 1, 2, 4, 8, 16, 24, 32 }) {
+        std::vector<std::vector<uint32_t> > strip(nstrip, std::vector<uint32_t>(NLED));
+        std::vector<const uint32_t*> strips;
+        for(auto& s : strip) {
+            for(auto& code : s) {
+                code = rng();
+            }
+            strips.push_back(s.data());
+        }
+        std::vector<uint32_t> bit_slots(24*NLED);
+        volatile uint32_t sink = 0;
+        double ref = strip_pixels_per_second([&]() {
+            grbz_to_bit_slots_reference(bit_slots.data(), strips.data(), nstrip, 0, NLED);
+            sink = sink + bit_slots[0]; }, nstrip, NLED);
+        double fast = strip_pixels_per_second([&]() {
+            grbz_to_bit_slots(bit_slots.data(), strips.data(), nstrip, 0, NLED);
+            sink = sink + bit_slots[0]; }, nstrip, NLED);
+        printf("%6d   %18.1f   %26.1f   %7.1f\n", nstrip, ref/1e6, fast/1e6, fast/ref);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "post_process.hpp"
+
+// Cost of the correction and dithering passes over a 2048 LED frame : the
+// table lookups of apply, the expansion to levels that dithering starts from
+// and one dithered frame, with the rebuild of the tables for scale. Then what
+// dithering buys at low brightness, in distinct output levels.
+
+namespace {
+    static constexpr unsigned NLED = 2048;
+    static constexpr int NREP = 2000;
+
+    // Best time of NREP runs of fn, in ns
+    template<typename Fn> double best_ns(Fn fn)
+    {
+        double best = 1e30;
+        for(int irep=0; irep<NREP; irep++) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+        return best;
+    }
+
+    void print_time(const char* name, double ns, unsigned n, const char* unit = "pixel")
+    {
+        printf("%-24s %10.1f us  %6.2f ns/%s\n", name, ns / 1000, ns / n, unit);
+    }
+}
+
+int main()
+{
+    std::vector<uint32_t> frame(NLED);
+    for(unsigned i=0; i<NLED; i++) {
+        frame[i] = (i * 2654435761u) & 0xFFFFFF00;
+    }
+    std::vector<uint32_t> out(NLED);
+    std::vector<uint16_t> level(3*NLED);
+    std::vector<uint8_t> error(3*NLED);
+    for(unsigned i=0; i<error.size(); i++) {
+        error[i] = uint8_t(i * 157);
+    }
+
+    PostProcessor pp;
+    pp.set_gamma(true);
+    pp.set_brightness(200);
+
+    printf("%u LEDs, best of %d\n", NLED, NREP);
+    print_time("copy (no correction)", best_ns([&]() {
+        std::copy(frame.begin(), frame.end(), out.begin());
+        asm volatile("" : : "r"(out.data()) : "memory");
+    }), NLED);
+    print_time("apply (gamma, 200)", best_ns([&]() {
+        std::copy(frame.begin(), frame.end(), out.begin());
+        pp.apply(out.data(), out.size());
+        asm volatile("" : : "r"(out.data()) : "memory");
+    }), NLED);
+    print_time("expand to levels", best_ns([&]() {
+        for(unsigned i=0; i<NLED; i++) {
+            pp.expand(frame[i], &level[3*i]);
+        }
+        asm volatile("" : : "r"(level.data()) : "memory");
+    }), NLED);
+    print_time("dither one frame", best_ns([&]() {
+        PostProcessor::dither(out.data(), level.data(), error.data(), NLED);
+        asm volatile("" : : "r"(out.data()) : "memory");
+    }), NLED);
+    int brightness = 1;
+    print_time("rebuild tables", best_ns([&]() {
+        pp.set_brightness(brightness++ & 0xFF);
+    }), 256, "entry");
+
+    // Distinct levels sent for the 256 input levels of one channel, and the
+    // largest difference between the mean dithered output and the exact level
+    pp.set_brightness(40);
+    int nplain = 0;
+    int ndithered = 0;
+    double max_error = 0;
+    int last_plain = -1;
+    double last_mean = -1;
+    for(uint32_t v=0; v<256; v++) {
+        int plain = pp.apply(v << 24) >> 24;
+        nplain += (plain != last_plain);
+        last_plain = plain;
+        uint16_t grb[3];
+        pp.expand(v << 24, grb);
+        uint8_t err[3] = { uint8_t(v * 157), 0, 0 };
+        uint32_t code;
+        long sum = 0;
+        for(int iframe=0; iframe<256; iframe++) {
+            PostProcessor::dither(&code, grb, err, 1);
+            sum += code >> 24;
+        }
+        double mean = sum / 256.0;
+        ndithered += (mean != last_mean);
+        last_mean = mean;
+        max_error = std::max(max_error, std::fabs(mean - grb[0] / 256.0));
+    }
+    printf("brightness 40, gamma : %d levels plain, %d dithered over 256 frames (mean error %.4f)\n",
+        nplain, ndithered, max_error);
+    return 0;
+}
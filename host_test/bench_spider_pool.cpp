@@ -0,0 +1,102 @@
+#include <cstdio>
+#include <list>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+#include "spider_pool.hpp"
+
+// A simulated hour of the spider run menu at 50 Hz on a 2048 LED chain, at
+// the highest spawn rate, for a few spider speeds : the pool against the
+// std::list of spiders it replaced, which allocated for every spawn. Also
+// how many spiders are live, against the limit of one for every two LEDs
+// that sizes the pool.
+
+namespace {
+    static constexpr int NLED = 2048;
+    static constexpr int MAX_SPIDERS = NLED / 2;
+    static constexpr int NFRAME = 3600 * 50;
+    static constexpr int SPAWN_RATE = 255;
+
+    struct Spider {
+        int x0;
+        int x1;
+        int xdest;
+        unsigned tupdate;
+        unsigned tnext;
+    };
+
+    void move_list(std::list<Spider>& spiders, std::minstd_rand& rng, int min_tupdate, int max_tupdate)
+    {
+        for(auto is = spiders.begin(); is != spiders.end();) {
+            if(--is->tnext == 0) {
+                is->tnext = is->tupdate;
+                if(is->x0 != is->x1) {
+                    is->x1 = is->x0;
+                } else if(is->x0 > is->xdest) {
+                    is->x0 -= 1;
+                } else if(is->x0 < is->xdest) {
+                    is->x0 += 1;
+                } else {
+                    is = spiders.erase(is);
+                    continue;
+                }
+            }
+            ++is;
+        }
+        unsigned ix = rng();
+        while((ix&0xFFF) < unsigned(SPAWN_RATE) and int(spiders.size()) < MAX_SPIDERS) {
+            int x = rng() % NLED;
+            int xd = rng() % NLED;
+            unsigned tu = min_tupdate;
+            if(max_tupdate > min_tupdate) {
+                tu += rng() % (max_tupdate - min_tupdate + 1);
+            }
+            spiders.push_back({ x, x, xd, tu, tu });
+            ix = rng();
+        }
+    }
+
+    void run(int min_tupdate, int max_tupdate)
+    {
+        static SpiderPool<MAX_SPIDERS> pool;
+        pool.nspider = 0;
+        std::minstd_rand rng(12939);
+        long sum_nspider = 0;
+        int max_nspider = 0;
+        int nframe_full = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for(int iframe=0; iframe<NFRAME; iframe++) {
+            pool.move();
+            pool.spawn(rng, NLED, SPAWN_RATE, min_tupdate, max_tupdate, MAX_SPIDERS);
+            sum_nspider += pool.nspider;
+            max_nspider = std::max(max_nspider, pool.nspider);
+            nframe_full += (pool.nspider == MAX_SPIDERS);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        std::list<Spider> spiders;
+        std::minstd_rand list_rng(12939);
+        for(int iframe=0; iframe<NFRAME; iframe++) {
+            move_list(spiders, list_rng, min_tupdate, max_tupdate);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double pool_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / NFRAME;
+        double list_us = std::chrono::duration<double, std::micro>(t2 - t1).count() / NFRAME;
+        printf("%4d..%-4d  %6.1f  %5d  %9.2f%%  %9.2f  %9.2f\n", min_tupdate, max_tupdate,
+            double(sum_nspider) / NFRAME, max_nspider, 100.0 * nframe_full / NFRAME, pool_us, list_us);
+    }
+}
+
+int main()
+{
+    printf("%d LEDs, %d frames (one hour at 50 Hz), spawn rate %d, at most %d spiders (%zu bytes)\n",
+        NLED, NFRAME, SPAWN_RATE, MAX_SPIDERS, sizeof(SpiderPool<MAX_SPIDERS>));
+    printf("speed        mean   peak  at limit   pool [us]  list [us]\n");
+    for(auto tupdate : { std::make_pair(1, 1), std::make_pair(10, 10), std::make_pair(1, 127),
+            std::make_pair(127, 127) }) {
+        run(tupdate.first, tupdate.second);
+    }
+    return 0;
+}
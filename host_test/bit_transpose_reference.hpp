@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// One bit at a time transpose, as ParallelPIO first did it, against which
+// grbz_to_bit_slots is checked and timed
+inline void grbz_to_bit_slots_reference(uint32_t* bit_slots, const uint32_t* const* strips,
+    int nstrip, int iled0, int nled)
+{
+    for(int iled=iled0; iled<iled0+nled; iled++) {
+        for(int ibit=31; ibit>=8; ibit--) {
+            uint32_t slot = 0;
+            for(int istrip=0; istrip<nstrip; istrip++) {
+                slot |= ((strips[istrip][iled] >> ibit) & 1u) << istrip;
+            }
+            *bit_slots++ = slot;
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Declaration of the clock query used by the c-sdk helpers of the PIO
+// programs, see pio.h
+
+enum clock_index { clk_sys = 5 };
+
+uint32_t clock_get_hz(enum clock_index clk_index);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Declarations of the interrupt and event helpers, see pico/time.h
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+void __sev(void);
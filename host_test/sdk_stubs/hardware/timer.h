@@ -0,0 +1,15 @@
+#pragma once
+
+#include "pico/time.h"
+
+// Declarations of the hardware alarm API, see pico/time.h
+
+#define NUM_ALARMS 4
+
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_unclaim(uint alarm_num);
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback);
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t);
+void hardware_alarm_cancel(uint alarm_num);
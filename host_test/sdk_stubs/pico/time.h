@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+
+// Declarations of the parts of the SDK time API that the frame scheduler
+// uses, so that it compiles on the host. They are defined by the test, on a
+// simulated clock.
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define hard_assert(x) assert(x)
+
+absolute_time_t get_absolute_time(void);
+uint64_t to_us_since_boot(absolute_time_t t);
+absolute_time_t from_us_since_boot(uint64_t us);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "bi_color_flashes.hpp"
+#include "pixel_code.hpp"
+
+// The flash list of the bi color menu against a model that keeps every
+// flash it starts, however many, and gives each LED the brightest of its
+// flashes. Both draw from the same random sequence, and must show the same
+// frame after every step, through changes of probability, decay curve and
+// chain length, up to every LED flashing at once.
+
+namespace {
+    struct Flash {
+        int iled;
+        int age;
+    };
+
+    struct Model {
+        std::vector<Flash> flash;
+        std::minstd_rand rng { 123 };
+
+        void generate(int nled, int decay, uint32_t non_flash_prob) {
+            std::vector<Flash> live;
+            for(Flash f : flash) {
+                ++f.age;
+                if(BiColorFlashes::decay_curve_level(decay, f.age) > 0 and f.iled < nled) {
+                    live.push_back(f);
+                }
+            }
+            flash.swap(live);
+            uint32_t x = rng();
+            for(int nflash=0; nflash<nled and x<non_flash_prob; ++nflash) {
+                flash.push_back({ int(rng() % nled), 0 });
+                x = rng();
+            }
+        }
+
+        void apply(uint32_t* color_codes, int decay, uint32_t fr, uint32_t fg, uint32_t fb) const {
+            for(const Flash& f : flash) {
+                uint32_t w = BiColorFlashes::decay_curve_level(decay, f.age);
+                uint32_t r,g,b;
+                grbz_to_rgb(color_codes[f.iled], r, g, b);
+                r = std::max(r, (fr * w + 127) / 255);
+                g = std::max(g, (fg * w + 127) / 255);
+                b = std::max(b, (fb * w + 127) / 255);
+                color_codes[f.iled] = rgb_to_grbz(r, g, b);
+            }
+        }
+    };
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    BiColorFlashes flashes;
+    Model model;
+    int nled = 300;
+    int flash_prob = 16;
+    int decay = 0;
+    int max_nflash = 0;
+    int nframe = 0;
+    int nfail = 0;
+    for(int istep=0; istep<200; istep++) {
+        switch(rng() % 4) {
+        case 0:
+            nled = 1 + rng() % 2048;
+            break;
+        case 1:
+            flash_prob = (rng() % 2) ? rng() % 257 : rng() % 4;
+            break;
+        case 2:
+            decay = rng() % BiColorFlashes::NUM_DECAY_CURVES;
+            break;
+        default:
+            break;
+        }
+        flashes.set_probability(flash_prob, nled);
+        for(int iframe=0; iframe<50; iframe++, nframe++) {
+            std::vector<uint32_t> background(nled);
+            for(auto& code : background) {
+                code = rng() & 0x3F3F3F00;
+            }
+            uint32_t fr = rng() % 256, fg = rng() % 256, fb = rng() % 256;
+            std::vector<uint32_t> frame = background;
+            std::vector<uint32_t> expected = background;
+            flashes.generate(decay);
+            flashes.apply(frame.data(), decay, fr, fg, fb);
+            model.generate(nled, decay, flashes.non_flash_prob());
+            model.apply(expected.data(), decay, fr, fg, fb);
+            max_nflash = std::max(max_nflash, flashes.nflash());
+            if(frame != expected or flashes.nflash() > nled) {
+                if(nfail == 0) {
+                    printf("FAIL: frame %d, %d LEDs, probability %d, decay %d, %d flashes\n",
+                        nframe, nled, flash_prob, decay, flashes.nflash());
+                }
+                ++nfail;
+            }
+        }
+    }
+    printf("%d frames, up to %d flashes, %d failed\n", nframe, max_nflash, nfail);
+    return nfail == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "bi_color_pattern.hpp"
+
+// The incremental render_period of the bi color menu against color_code,
+// which calculates each LED on its own. Every period up to 64 is swept over
+// hold and balance, with random colors and phases, then random long periods.
+// Both the forward render and the reversed one (used when the pattern starts
+// at the far end of the chain) must match color_code exactly. The blend that
+// scrolls a period by a fraction of an LED must leave it alone at zero, and
+// otherwise give each channel a level between those of the LED and the one
+// before it.
+
+namespace {
+    int check(BiColorPattern& pattern, int period, int hold, int balance, std::mt19937& rng)
+    {
+        pattern.set_colors(rng()%256, rng()%256, rng()%256, rng()%256, rng()%256, rng()%256);
+        pattern.set_geometry(period, hold, balance);
+        pattern.set_phase(rng() % 65536);
+
+        int nled = std::min(2 * period + int(rng() % 8), 4096);
+        std::vector<uint32_t> forward(nled);
+        std::vector<uint32_t> reversed(nled);
+        pattern.render_period(forward.data(), 1, nled);
+        pattern.render_period(&reversed[nled-1], -1, nled);
+
+        int nfail = 0;
+        for(int iled=0; iled<nled; iled++) {
+            uint32_t expected = pattern.color_code(iled);
+            if(forward[iled] != expected or reversed[nled-1-iled] != expected) {
+                if(nfail == 0) {
+                    printf("FAIL: period %d hold %d balance %d led %d : %08x %08x expected %08x\n",
+                        period, hold, balance, iled, forward[iled], reversed[nled-1-iled], expected);
+                }
+                ++nfail;
+            }
+        }
+        return nfail;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    BiColorPattern pattern;
+    int ncase = 0;
+    int nfail = 0;
+    for(int period=2; period<=64; period++) {
+        for(int hold=0; hold<=127; hold+=7) {
+            for(int balance=-128; balance<=128; balance+=16) {
+                nfail += check(pattern, period, hold, balance, rng) != 0;
+                ++ncase;
+            }
+        }
+    }
+    for(int icase=0; icase<2000; icase++) {
+        int period = 2 + rng() % 4095;
+        int hold = rng() % 128;
+        int balance = int(rng() % 257) - 128;
+        nfail += check(pattern, period, hold, balance, rng) != 0;
+        ++ncase;
+    }
+    for(int p=2; p<=1024; p*=2) {
+        std::vector<uint32_t> period(p);
+        for(auto& code : period) {
+            code = rng() & 0xFFFFFF00;
+        }
+        for(int blend=0; blend<256; blend++) {
+            std::vector<uint32_t> forward(p);
+            std::vector<uint32_t> reversed(p);
+            BiColorPattern::blend_period(period.data(), forward.data(), p, blend);
+            BiColorPattern::blend_period(period.data(), reversed.data(), p, blend, true);
+            bool ok = blend != 0 or forward == period;
+            for(int j=0; j<p; j++) {
+                uint32_t a = period[j];
+                uint32_t b = period[(j + p - 1) % p];
+                ok = ok and reversed[p-1-j] == forward[j] and (forward[j] & 0xFF) == 0;
+                for(int bit=8; bit<32; bit+=8) {
+                    uint32_t c = (forward[j] >> bit) & 0xFF;
+                    uint32_t ca = (a >> bit) & 0xFF;
+                    uint32_t cb = (b >> bit) & 0xFF;
+                    ok = ok and c >= std::min(ca, cb) and c <= std::max(ca, cb);
+                }
+            }
+            if(!ok) {
+                printf("FAIL: blend period %d blend %d\n", p, blend);
+            }
+            nfail += !ok;
+            ++ncase;
+        }
+    }
+    printf("%d cases, %d failed\n", ncase, nfail);
+    return nfail == 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+
+#include "bit_transpose.hpp"
+#include "bit_transpose_reference.hpp"
+
+// grbz_to_bit_slots against the one bit at a time reference, for 1 to 32
+// strips, random codes, lengths and starting pixels
+
+int main()
+{
+    std::mt19937 rng(1);
+    int nfail = 0;
+    int ntrial = 0;
+    for(int nstrip=1; nstrip<=32; nstrip++) {
+        for(int itrial=0; itrial<50; itrial++, ntrial++) {
+            int nled = 1 + rng()%40;
+            int iled0 = rng()%5;
+            std::vector<std::vector<uint32_t> > strip(nstrip, std::vector<uint32_t>(iled0+nled));
+            std::vector<const uint32_t*> strips;
+            for(auto& s : strip) {
+                for(auto& code : s) {
+                    code = rng();
+                }
+                strips.push_back(s.data());
+            }
+            std::vector<uint32_t> fast(24*nled, 0xDEADBEEF);
+            std::vector<uint32_t> ref(24*nled);
+            grbz_to_bit_slots(fast.data(), strips.data(), nstrip, iled0, nled);
+            grbz_to_bit_slots_reference(ref.data(), strips.data(), nstrip, iled0, nled);
+            if(fast != ref) {
+                if(nfail < 5) {
+                    printf("FAIL : nstrip = %d  iled0 = %d  nled = %d\n", nstrip, iled0, nled);
+                }
+                ++nfail;
+            }
+        }
+    }
+    printf("grbz_to_bit_slots : %d trials, %d failures\n", ntrial, nfail);
+    return nfail == 0 ? 0 : 1;
+}
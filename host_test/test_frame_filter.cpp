@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "frame_hash.hpp"
+
+// Identical-frame skipping and prefix truncation, as send_frame uses them,
+// against sending every frame in full. A model chain is updated with what
+// FrameFilter and changed_prefix say to send (the skipped frames not at all,
+// the truncated ones segment by segment) and must show, after every frame,
+// exactly what it would have shown had the frame been sent in full.
+
+namespace {
+    struct Chain {
+        int nled;
+        int nsegment;
+        bool back;
+        int segment_nled() const { return (nled + nsegment - 1) / nsegment; }
+    };
+
+    // Chain contents with the frame sent in full, padded with zeros
+    void render_full(std::vector<uint32_t>& chain, const Chain& c, const std::vector<uint32_t>& frame)
+    {
+        unsigned offset = c.back ? c.nled - frame.size() : 0;
+        std::fill(chain.begin(), chain.end(), 0);
+        std::copy(frame.begin(), frame.end(), chain.begin() + offset);
+    }
+
+    // Next frame of a sequence mixing repeats, small and large changes
+    void next_frame(std::vector<uint32_t>& frame, std::mt19937& rng)
+    {
+        switch(rng() % 4) {
+        case 0:
+            break;
+        case 1:
+            frame[rng() % frame.size()] = rng() & 0xFFFFFF00;
+            break;
+        case 2:
+            for(unsigned n=rng()%8; n>0; n--) {
+                frame[rng() % frame.size()] ^= 0x01000000 << (rng() % 8);
+            }
+            break;
+        default:
+            for(auto& code : frame) {
+                code = rng() & 0xFFFFFF00;
+            }
+            break;
+        }
+    }
+
+    int run_sequence(const Chain& c, unsigned nframe_pixel, int refresh_interval,
+        unsigned nframe, std::mt19937& rng, unsigned& nskipped, unsigned& nsent, unsigned& nfull)
+    {
+        FrameFilter filter;
+        filter.claim();
+        std::vector<uint32_t> frame(nframe_pixel, 0);
+        std::vector<uint32_t> last_frame(nframe_pixel, 0);
+        std::vector<uint32_t> chain(c.nled, 0xDEADBEEF);
+        std::vector<uint32_t> expected(c.nled);
+        unsigned offset = c.back ? c.nled - nframe_pixel : 0;
+        bool last_frame_shown = false;
+        int nfail = 0;
+        for(unsigned iframe=0; iframe<nframe; iframe++) {
+            next_frame(frame, rng);
+            // Now and then something else is sent in between
+            if(rng() % 50 == 0) {
+                std::fill(chain.begin(), chain.end(), 0xDEADBEEF);
+                last_frame_shown = false;
+            }
+            FrameFilter::Action action = filter.filter(frame.data(), frame.size(),
+                refresh_interval, last_frame_shown);
+            render_full(expected, c, frame);
+            if(action == FrameFilter::SEND_FULL) {
+                chain = expected;
+                nsent += c.nled;
+                nfull += c.nled;
+            } else if(action == FrameFilter::SEND_PREFIX) {
+                unsigned seg_nled = c.segment_nled();
+                for(int iseg=0; iseg<c.nsegment; iseg++) {
+                    unsigned ichain0 = iseg*seg_nled;
+                    unsigned ichain1 = (iseg == c.nsegment-1) ? unsigned(c.nled) : (iseg+1)*seg_nled;
+                    unsigned npixel = changed_prefix(frame.data(), last_frame.data(), frame.size(),
+                        ichain0, ichain1, offset);
+                    std::copy(expected.begin() + ichain0, expected.begin() + ichain0 + npixel,
+                        chain.begin() + ichain0);
+                    nsent += npixel;
+                }
+                nfull += c.nled;
+            } else {
+                ++nskipped;
+                nfull += c.nled;
+            }
+            if(action != FrameFilter::SKIP) {
+                last_frame = frame;
+                last_frame_shown = true;
+            }
+            if(chain != expected) {
+                if(nfail < 5) {
+                    printf("FAIL : nled = %d  nsegment = %d  back = %d  refresh = %d  frame %u\n",
+                        c.nled, c.nsegment, int(c.back), refresh_interval, iframe);
+                }
+                ++nfail;
+                chain = expected;
+            }
+        }
+        return nfail;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    int nfail = 0;
+    int nsequence = 0;
+    unsigned nskipped = 0;
+    unsigned nsent = 0;
+    unsigned nfull = 0;
+    for(int refresh_interval=0; refresh_interval<=8; refresh_interval++) {
+        for(int nsegment=1; nsegment<=4; nsegment++) {
+            for(int itrial=0; itrial<20; itrial++, nsequence++) {
+                Chain c;
+                c.nled = nsegment + rng() % 300;
+                c.nsegment = nsegment;
+                c.back = (rng() & 1) != 0;
+                unsigned nframe_pixel = 1 + rng() % c.nled;
+                nfail += run_sequence(c, nframe_pixel, refresh_interval, 200, rng,
+                    nskipped, nsent, nfull);
+            }
+        }
+    }
+    printf("FrameFilter : %d sequences, %u frames skipped, %u of %u pixels sent, %d failures\n",
+        nsequence, nskipped, nsent, nfull, nfail);
+    return nfail == 0 ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <cstdint>
+
+#include "frame_scheduler.hpp"
+#include "hardware/sync.h"
+
+// The frame scheduler on a simulated clock and alarm : deadlines fall on the
+// exact grid of the period, even when it is not a whole number of us, frames
+// taken late are counted as missed rather than sent in a burst, deadlines
+// that pass while the alarm interrupt is held off are all counted, and rates
+// down to zero give a usable period.
+
+namespace {
+    uint64_t now_us = 0;
+    hardware_alarm_callback_t alarm_callback = nullptr;
+    bool alarm_claimed = false;
+    bool alarm_armed = false;
+    uint64_t alarm_target_us = 0;
+
+    // Move the clock on to t_us, calling the alarm at each target on the
+    // way, or only once at t_us if the interrupt is held off until then
+    void advance_to(uint64_t t_us, bool held_off = false)
+    {
+        if(held_off) {
+            now_us = t_us;
+            if(alarm_armed and alarm_target_us <= now_us) {
+                alarm_armed = false;
+                alarm_callback(0);
+            }
+            return;
+        }
+        while(alarm_armed and alarm_target_us <= t_us) {
+            now_us = alarm_target_us;
+            alarm_armed = false;
+            alarm_callback(0);
+        }
+        now_us = t_us;
+    }
+
+    int nfail = 0;
+    int ncheck = 0;
+    void check(bool ok, const char* what)
+    {
+        ++ncheck;
+        if(!ok) {
+            printf("FAIL: %s\n", what);
+            ++nfail;
+        }
+    }
+}
+
+absolute_time_t get_absolute_time(void) { return now_us; }
+uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return int64_t(to - from); }
+
+int hardware_alarm_claim_unused(bool) { alarm_claimed = true; return 0; }
+void hardware_alarm_unclaim(uint) { alarm_claimed = false; }
+void hardware_alarm_set_callback(uint, hardware_alarm_callback_t callback) { alarm_callback = callback; }
+void hardware_alarm_cancel(uint) { alarm_armed = false; }
+bool hardware_alarm_set_target(uint, absolute_time_t t)
+{
+    // As on the device, a target that has already passed is not armed
+    if(t <= now_us) {
+        return true;
+    }
+    alarm_target_us = t;
+    alarm_armed = true;
+    return false;
+}
+
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t) { }
+void __sev(void) { }
+
+int main()
+{
+    // Periods
+    check(FrameScheduler::period_from_interval_us(20000) == 20000 << 8, "period of 20 ms");
+    check(FrameScheduler::period_from_rate_mhz(50000) == 20000 << 8, "period of 50 Hz");
+    check(FrameScheduler::period_from_rate_mhz(60000) == 4266667, "period of 60 Hz");
+    uint32_t min_period = FrameScheduler::period_from_rate_mhz(FrameScheduler::MIN_RATE_MHZ);
+    check(min_period > 16000000u << 8, "slowest period about 16 s");
+    check(FrameScheduler::period_from_rate_mhz(0) == min_period, "rate of zero clamped");
+    check(FrameScheduler::period_from_rate_mhz(1) == min_period, "rate below the minimum clamped");
+    check(FrameScheduler::period_from_rate_mhz(FrameScheduler::MIN_RATE_MHZ + 1) < min_period,
+        "rate above the minimum not clamped");
+    check(FrameScheduler::period_from_rate_mhz(UINT32_MAX) > 0, "fastest rate has a period");
+
+    // Frames on the grid at 60 Hz : the first is due at once, the deadline
+    // of frame n is n periods on, in whole us, which stays within a us of
+    // n/60 s, and none are missed
+    {
+        now_us = 1000;
+        FrameScheduler scheduler;
+        const uint32_t period = FrameScheduler::period_from_rate_mhz(60000);
+        scheduler.start(period);
+        check(scheduler.frame_due() and scheduler.take_frame() == 0, "first frame due at start");
+        bool on_grid = true;
+        for(int n=1; n<=600; n++) {
+            uint64_t deadline_us = 1000 + ((uint64_t(n) * period) >> 8);
+            int64_t exact_error_us = int64_t(deadline_us - 1000) - int64_t(uint64_t(n) * 1000000 / 60);
+            on_grid = on_grid and exact_error_us >= -1 and exact_error_us <= 1;
+            advance_to(deadline_us - 1);
+            on_grid = on_grid and !scheduler.frame_due();
+            advance_to(deadline_us);
+            on_grid = on_grid and scheduler.frame_due() and scheduler.take_frame() == 0;
+        }
+        check(on_grid, "deadlines on the 60 Hz grid");
+        check(scheduler.frame_count() == 601 and scheduler.missed_count() == 0, "no frames missed");
+    }
+
+    // An effect that falls behind : the deadlines passed before the frame
+    // is taken are missed, and the lateness is from the last of them
+    {
+        now_us = 0;
+        FrameScheduler scheduler;
+        scheduler.start(FrameScheduler::period_from_interval_us(20000));
+        scheduler.take_frame();
+        advance_to(5 * 20000 + 300);
+        check(scheduler.frame_due() and scheduler.take_frame() == 300, "late frame lateness");
+        check(scheduler.frame_count() == 6 and scheduler.missed_count() == 4, "late frame missed count");
+        check(scheduler.max_late_us() == 300, "max lateness");
+        check(!scheduler.frame_due(), "no burst after a late frame");
+
+        // The alarm interrupt held off for three periods : all the deadlines
+        // that passed are counted, and the alarm set for the next one
+        advance_to(9 * 20000 + 10, true);
+        check(scheduler.take_frame() == 10, "held off alarm lateness");
+        check(scheduler.frame_count() == 10 and scheduler.missed_count() == 7, "held off alarm missed count");
+        advance_to(10 * 20000);
+        check(scheduler.frame_due() and scheduler.take_frame() == 0, "alarm set after being held off");
+
+        scheduler.stop();
+        check(!scheduler.running() and !alarm_claimed and !alarm_armed, "alarm released on stop");
+    }
+
+    // A rate of zero runs at the slowest rate rather than dividing by zero
+    {
+        now_us = 0;
+        FrameScheduler scheduler;
+        scheduler.start(FrameScheduler::period_from_rate_mhz(0));
+        scheduler.take_frame();
+        uint64_t period_us = min_period >> 8;
+        advance_to(period_us - 1);
+        check(!scheduler.frame_due(), "rate of zero : no frame before the slowest period");
+        advance_to(period_us);
+        check(scheduler.frame_due(), "rate of zero : frame at the slowest period");
+    }
+
+    printf("%d checks, %d failed\n", ncheck, nfail);
+    return nfail == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#include "lockfree.hpp"
+
+// SPSCQueue and SeqLock with the two sides on their own threads, as the two
+// cores use them. The queue must deliver every value once and in order, and
+// the readers of the lock must never see a torn or older value.
+
+namespace {
+    struct Record {
+        uint32_t a, b, c, d;
+        uint16_t e; // leaves a partial last word
+    };
+
+    Record make_record(uint32_t i)
+    {
+        return { i, i*3, i*5, ~i, uint16_t(i) };
+    }
+
+    bool record_consistent(const Record& r)
+    {
+        return r.b == r.a*3 and r.c == r.a*5 and r.d == ~r.a and r.e == uint16_t(r.a);
+    }
+
+    int test_queue(unsigned nvalue)
+    {
+        // A short queue, so that it is often full and often empty
+        SPSCQueue<uint32_t, 16> queue;
+        std::thread producer([&queue,nvalue]() {
+            for(uint32_t i=0; i<nvalue; ) {
+                if(queue.push(i)) {
+                    ++i;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        int nfail = 0;
+        uint32_t expected = 0;
+        uint32_t value;
+        while(expected < nvalue) {
+            if(queue.pop(value)) {
+                if(value != expected) {
+                    if(nfail < 5) {
+                        printf("FAIL : SPSCQueue popped %u, expected %u\n", value, expected);
+                    }
+                    ++nfail;
+                }
+                ++expected;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        if(!queue.empty() or queue.pop(value)) {
+            printf("FAIL : SPSCQueue not empty at the end\n");
+            ++nfail;
+        }
+        printf("SPSCQueue : %u values, %d failures\n", nvalue, nfail);
+        return nfail;
+    }
+
+    int test_seqlock(unsigned nwrite, unsigned nreader)
+    {
+        SeqLock<Record> lock;
+        std::atomic<bool> done { false };
+        std::vector<int> nfail(nreader, 0);
+        std::vector<unsigned> nread(nreader, 0);
+        std::vector<std::thread> readers;
+        for(unsigned ireader=0; ireader<nreader; ireader++) {
+            readers.emplace_back([&,ireader]() {
+                uint32_t seq = 0;
+                uint32_t last = 0;
+                Record r;
+                // One last read after the writer is done, to see the final value
+                bool finished = false;
+                while(!finished) {
+                    finished = done.load();
+                    if(lock.read_if_newer(r, seq)) {
+                        if(!record_consistent(r) or r.a < last) {
+                            ++nfail[ireader];
+                        }
+                        last = r.a;
+                        ++nread[ireader];
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+                if(last != nwrite) {
+                    ++nfail[ireader];
+                }
+            });
+        }
+        for(uint32_t i=1; i<=nwrite; i++) {
+            lock.write(make_record(i));
+            if((i & 255) == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+        for(auto& reader : readers) {
+            reader.join();
+        }
+        int nfail_total = 0;
+        unsigned nread_total = 0;
+        for(unsigned ireader=0; ireader<nreader; ireader++) {
+            nfail_total += nfail[ireader];
+            nread_total += nread[ireader];
+        }
+        Record r = lock.read();
+        if(!record_consistent(r) or r.a != nwrite) {
+            printf("FAIL : SeqLock final value %u, expected %u\n", r.a, nwrite);
+            ++nfail_total;
+        }
+        printf("SeqLock : %u writes, %u readers, %u reads, %d failures\n",
+            nwrite, nreader, nread_total, nfail_total);
+        return nfail_total;
+    }
+}
+
+int main()
+{
+    int nfail = 0;
+    nfail += test_queue(1000000);
+    nfail += test_seqlock(1000000, 1);
+    nfail += test_seqlock(200000, 3);
+    return nfail == 0 ? 0 : 1;
+}
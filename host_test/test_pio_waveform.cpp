@@ -0,0 +1,341 @@
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <random>
+#include <algorithm>
+
+#include "led_chip.hpp"
+#include "ws2812.pio.h"
+#include "apa102.pio.h"
+
+// The PIO programs, as assembled by pioasm and given the delays of each chip
+// profile, run cycle by cycle on a model state machine. The waveform of every
+// profile must carry the bits sent, with the high and low times of each bit
+// inside the datasheet windows, and with ws2812_latched every frame must be
+// followed by a latch at least as long as the profile asks for. The clocked
+// profiles run apa102, whose data must be stable at each rising clock edge.
+
+namespace {
+    // State machine running the instructions the LED programs use (jmp, out,
+    // pull, mov and nop), with one side-set pin (bit 12, delays in bits 8-11),
+    // one out pin, the OSR shifting left and autopull on. It runs until it
+    // stalls with an empty FIFO, recording the levels of the pins.
+    class StateMachine {
+    public:
+        struct Levels {
+            uint64_t cycle;
+            int side;
+            int out;
+        };
+
+        StateMachine(const pio_program_t& program, uint wrap_target, uint wrap, uint pull_threshold):
+            program_(program), wrap_target_(wrap_target), wrap_(wrap), pull_threshold_(pull_threshold)
+        {
+            // nothing to see here
+        }
+
+        void push(uint32_t word) { fifo_.push_back(word); }
+        // Stay stalled for ncycle cycles, as while the CPU times a latch
+        void idle(uint64_t ncycle) { cycle_ += ncycle; }
+        uint64_t cycle() const { return cycle_; }
+        const std::vector<Levels>& trace() const { return trace_; }
+
+        // Returns false on an instruction the model does not know
+        bool run(uint64_t max_cycles = 100000000) {
+            while(cycle_ < max_cycles) {
+                if(osr_count_ >= pull_threshold_ and !fifo_.empty()) {
+                    osr_ = fifo_.front();
+                    fifo_.pop_front();
+                    osr_count_ = 0;
+                }
+                uint16_t instr = program_.instructions[pc_];
+                uint delay = (instr >> 8) & 0xF;
+                uint next = (pc_ == wrap_) ? wrap_target_ : pc_ + 1;
+                // The side-set is applied even if the instruction stalls
+                set_pins((instr >> 12) & 1, out_);
+                bool stall = false;
+                switch(instr >> 13) {
+                case 0: { // jmp
+                    bool jump = false;
+                    switch((instr >> 5) & 7) {
+                    case 0: jump = true; break;
+                    case 1: jump = (x_ == 0); break;
+                    case 2: jump = (x_ != 0); x_--; break;
+                    case 3: jump = (y_ == 0); break;
+                    case 4: jump = (y_ != 0); y_--; break;
+                    default: return false;
+                    }
+                    if(jump) {
+                        next = instr & 0x1F;
+                    }
+                    break; }
+                case 3: { // out, stalling when autopull finds the FIFO empty
+                    if(osr_count_ >= pull_threshold_) {
+                        stall = true;
+                        break;
+                    }
+                    uint nbit = instr & 0x1F;
+                    nbit = (nbit == 0) ? 32 : nbit;
+                    uint32_t value = (nbit == 32) ? osr_ : (osr_ >> (32 - nbit));
+                    osr_ = (nbit == 32) ? 0 : (osr_ << nbit);
+                    osr_count_ = std::min(osr_count_ + nbit, 32u);
+                    switch((instr >> 5) & 7) {
+                    case 0: set_pins((instr >> 12) & 1, value & 1); break;
+                    case 1: x_ = value; break;
+                    case 2: y_ = value; break;
+                    case 6: isr_ = value; break;
+                    default: return false;
+                    }
+                    break; }
+                case 4: // pull block, a no-op when autopull has filled the OSR
+                    if((instr & 0xE0) != 0xA0) {
+                        return false;
+                    }
+                    if(osr_count_ == 0) {
+                        break;
+                    }
+                    if(fifo_.empty()) {
+                        stall = true;
+                        break;
+                    }
+                    osr_ = fifo_.front();
+                    fifo_.pop_front();
+                    osr_count_ = 0;
+                    break;
+                case 5: { // mov, and nop (mov y, y)
+                    uint32_t value;
+                    switch(instr & 7) {
+                    case 1: value = x_; break;
+                    case 2: value = y_; break;
+                    case 3: value = 0; break;
+                    case 6: value = isr_; break;
+                    default: return false;
+                    }
+                    if(((instr >> 3) & 3) == 1) {
+                        value = ~value;
+                    } else if(((instr >> 3) & 3) != 0) {
+                        return false;
+                    }
+                    switch((instr >> 5) & 7) {
+                    case 1: x_ = value; break;
+                    case 2: y_ = value; break;
+                    case 6: isr_ = value; break;
+                    default: return false;
+                    }
+                    break; }
+                default:
+                    return false;
+                }
+                if(stall) {
+                    // The FIFO is empty, or the OSR would have been refilled
+                    return true;
+                }
+                cycle_ += 1 + delay;
+                pc_ = next;
+            }
+            return false;
+        }
+
+    private:
+        void set_pins(int side, int out) {
+            if(trace_.empty() or side != side_ or out != out_) {
+                trace_.push_back({ cycle_, side, out });
+            }
+            side_ = side;
+            out_ = out;
+        }
+
+        pio_program_t program_;
+        uint wrap_target_;
+        uint wrap_;
+        uint pull_threshold_;
+        std::deque<uint32_t> fifo_;
+        uint32_t osr_ = 0;
+        uint osr_count_ = 32;
+        uint32_t x_ = 0;
+        uint32_t y_ = 0;
+        uint32_t isr_ = 0;
+        uint pc_ = 0;
+        uint64_t cycle_ = 0;
+        int side_ = 0;
+        int out_ = 0;
+        std::vector<Levels> trace_;
+    };
+
+    typedef std::vector<int> Bits;
+
+    // Random frames of 1 to 40 pixels, with their bits in the order sent
+    std::vector<std::vector<uint32_t> > make_frames(std::mt19937& rng, bool rgbw, Bits& bits)
+    {
+        std::vector<std::vector<uint32_t> > frames(4);
+        for(auto& frame : frames) {
+            frame.resize(1 + rng() % 40);
+            for(auto& code : frame) {
+                code = rgbw ? uint32_t(rng()) : (rng() & 0xFFFFFF00);
+                for(int ibit=0; ibit<(rgbw ? 32 : 24); ibit++) {
+                    bits.push_back((code >> (31 - ibit)) & 1);
+                }
+            }
+        }
+        return frames;
+    }
+
+    // Decode the data line of a ws2812 program, checking every bit against
+    // the windows of the profile. Lows longer than any bit are latches, and
+    // their lengths in ns are returned in latch_ns.
+    int decode_ws2812(const ChipProfile& p, const StateMachine& sm, Bits& bits,
+        std::vector<double>& latch_ns)
+    {
+        const ChipTimingWindow& w = p.window;
+        double cycle_ns = 1e9 / (double(p.baudrate) * p.cycles_per_bit());
+        double threshold_ns = (p.t0h_ns() + p.t1h_ns()) / 2.0;
+        double max_low_ns = std::max(w.t0l_max, w.t1l_max);
+        const auto& trace = sm.trace();
+        int nfail = 0;
+        for(size_t i=0; i<trace.size(); i++) {
+            if(trace[i].side != 1) {
+                continue;
+            }
+            uint64_t fall = (i+1 < trace.size()) ? trace[i+1].cycle : sm.cycle();
+            uint64_t rise = (i+2 < trace.size()) ? trace[i+2].cycle : sm.cycle();
+            double high_ns = (fall - trace[i].cycle) * cycle_ns;
+            double low_ns = (rise - fall) * cycle_ns;
+            int bit = high_ns > threshold_ns;
+            bits.push_back(bit);
+            if(bit ? (high_ns < w.t1h_min or high_ns > w.t1h_max)
+                    : (high_ns < w.t0h_min or high_ns > w.t0h_max)) {
+                ++nfail;
+            }
+            if(low_ns > max_low_ns) {
+                latch_ns.push_back(low_ns);
+            } else if(bit ? (low_ns < w.t1l_min or low_ns > w.t1l_max)
+                    : (low_ns < w.t0l_min or low_ns > w.t0l_max)) {
+                ++nfail;
+            }
+        }
+        return nfail;
+    }
+
+    int test_ws2812(const ChipProfile& p, bool rgbw, bool latched, std::mt19937& rng)
+    {
+        uint16_t instructions[32];
+        pio_program_t program = latched
+            ? ws2812_latched_program_with_timing(instructions, p.t1, p.t2, p.t3)
+            : ws2812_program_with_timing(instructions, p.t1, p.t2, p.t3);
+        StateMachine sm(program,
+            latched ? ws2812_latched_wrap_target : ws2812_wrap_target,
+            latched ? ws2812_latched_wrap : ws2812_wrap, rgbw ? 32 : 24);
+
+        // The latch in cycles, as SerialPIO computes it
+        uint64_t pio_hz = uint64_t(p.baudrate) * p.cycles_per_bit();
+        uint32_t latch_cycles = uint32_t(uint64_t(p.latch_us) * pio_hz / 1000000);
+
+        // With ws2812 each frame is sent once the previous one is latched,
+        // with ws2812_latched they are all queued back to back
+        Bits sent;
+        auto frames = make_frames(rng, rgbw, sent);
+        bool ok = true;
+        for(const auto& frame : frames) {
+            if(latched) {
+                sm.push(ws2812_latched_header(frame.size() * (rgbw ? 32 : 24), latch_cycles));
+            }
+            for(uint32_t code : frame) {
+                sm.push(code);
+            }
+            if(!latched) {
+                ok = ok and sm.run();
+                sm.idle(latch_cycles);
+            }
+        }
+        if(latched) {
+            ok = ok and sm.run();
+        }
+        if(!ok) {
+            printf("FAIL : %s %s %s : unknown instruction or runaway\n", p.name,
+                latched ? "ws2812_latched" : "ws2812", rgbw ? "RGBW" : "RGB");
+            return 1;
+        }
+
+        Bits received;
+        std::vector<double> latch_ns;
+        int nwindow = decode_ws2812(p, sm, received, latch_ns);
+        int nlatch = 0;
+        double min_latch_ns = latch_ns.empty() ? 0 : *std::min_element(latch_ns.begin(), latch_ns.end());
+        if(latch_ns.size() != frames.size()) {
+            ++nlatch;
+        }
+        if(latched and (min_latch_ns < p.latch_us * 1000.0 or min_latch_ns < p.window.latch_min_us * 1000.0)) {
+            ++nlatch;
+        }
+        int nfail = (received != sent) + (nwindow > 0) + (nlatch > 0);
+        printf("%-12s %-14s %-4s : %4zu bits %s, %d outside windows, %zu latches of %.1f us or more%s\n",
+            p.name, latched ? "ws2812_latched" : "ws2812", rgbw ? "RGBW" : "RGB",
+            sent.size(), received == sent ? "ok" : "WRONG", nwindow, latch_ns.size(),
+            min_latch_ns / 1000, nfail ? "  FAIL" : "");
+        return nfail;
+    }
+
+    int test_apa102(const ChipProfile& p, std::mt19937& rng)
+    {
+        StateMachine sm(apa102_program, apa102_wrap_target, apa102_wrap, 32);
+        // A start frame, LED frames and end frames, as SerialPIO sends them
+        std::vector<uint32_t> words(1, 0);
+        for(int i=0; i<40; i++) {
+            words.push_back(0xE0000000 | rng());
+        }
+        words.push_back(0);
+        words.push_back(0);
+        for(uint32_t word : words) {
+            sm.push(word);
+        }
+        if(!sm.run()) {
+            printf("FAIL : %s apa102 : unknown instruction or runaway\n", p.name);
+            return 1;
+        }
+
+        // Sample the data at each rising edge of the clock, which must not
+        // move with it, and check that the clock is left low
+        const auto& trace = sm.trace();
+        std::vector<uint32_t> received;
+        uint32_t word = 0;
+        int nbit = 0;
+        int nunstable = 0;
+        for(size_t i=1; i<trace.size(); i++) {
+            if(trace[i].side == 1 and trace[i-1].side == 0) {
+                nunstable += (trace[i].out != trace[i-1].out);
+                word = (word << 1) | trace[i].out;
+                if(++nbit == 32) {
+                    received.push_back(word);
+                    nbit = 0;
+                }
+            }
+        }
+        bool idle_low = trace.back().side == 0;
+        // The program runs at twice the bit rate, two cycles a bit
+        double bit_ns = 2 * 1e9 / (2.0 * p.baudrate);
+        int nfail = (received != words) + (nunstable > 0) + !idle_low;
+        printf("%-12s %-14s %-4s : %4zu words %s, %.0f ns a bit, data %s, clock left %s%s\n",
+            p.name, "apa102", "", words.size(), received == words ? "ok" : "WRONG", bit_ns,
+            nunstable ? "UNSTABLE" : "stable", idle_low ? "low" : "HIGH", nfail ? "  FAIL" : "");
+        return nfail;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    int nfail = 0;
+    for(const auto& p : CHIP_PROFILES) {
+        if(p.clocked) {
+            nfail += test_apa102(p, rng);
+            continue;
+        }
+        for(bool latched : { false, true }) {
+            for(bool rgbw : { false, true }) {
+                nfail += test_ws2812(p, rgbw, latched, rng);
+            }
+        }
+    }
+    printf("PIO waveforms : %d failures\n", nfail);
+    return nfail == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+
+#include "power_limit.hpp"
+
+// The power budget of send_frame : frames within the budget are left alone,
+// frames over it are scaled to within it (and not far below), frames with
+// every level at zero only draw the idle current, and a budget the idle
+// current alone exceeds blanks the frame. For each chip profile, with random
+// frames from dark to full white.
+
+namespace {
+    PowerLimiter::LevelSums sum_levels(const std::vector<uint32_t>& codes)
+    {
+        PowerLimiter::LevelSums sums = { };
+        for(uint32_t code : codes) {
+            sums.add(code);
+        }
+        return sums;
+    }
+
+    void random_frame(std::vector<uint32_t>& codes, std::mt19937& rng, bool rgbw)
+    {
+        // The largest level of the frame, so the sums span dark to full white
+        uint32_t max_level = rng() % 256;
+        for(auto& code : codes) {
+            code = 0;
+            for(int ichan=0; ichan<(rgbw ? 4 : 3); ichan++) {
+                code |= (rng() % (max_level + 1)) << (24 - 8*ichan);
+            }
+        }
+    }
+}
+
+int main()
+{
+    const PowerProfile* profiles[] = { &WS2812_POWER, &SK6812_RGBW_POWER, &APA102_POWER };
+    std::mt19937 rng(1);
+    int ncase = 0;
+    int nfail = 0;
+    auto check = [&](bool ok, const char* what, int nled, int budget_ma) {
+        ++ncase;
+        if(!ok) {
+            if(nfail < 10) {
+                printf("FAIL: %s, %d LEDs, budget %d mA\n", what, nled, budget_ma);
+            }
+            ++nfail;
+        }
+    };
+
+    for(const PowerProfile* profile : profiles) {
+        bool rgbw = profile->full_ua[3] != 0;
+        PowerLimiter limiter;
+        limiter.set_profile(*profile);
+        check(!limiter.enabled(), "enabled without a budget", 0, 0);
+
+        for(int icase=0; icase<2000; icase++) {
+            int nled = 1 + rng() % 2048;
+            int budget_ma = 1 + rng() % 20000;
+            limiter.set_budget_ma(budget_ma);
+            std::vector<uint32_t> codes(nled);
+            random_frame(codes, rng, rgbw);
+            PowerLimiter::LevelSums sums = sum_levels(codes);
+            uint32_t idle_ma = (uint64_t(profile->idle_ua) * nled + 500) / 1000;
+            uint32_t factor = limiter.scale_factor(sums, nled);
+            uint32_t current_ma = limiter.current_ma(sums, nled);
+
+            if(idle_ma > uint32_t(budget_ma)) {
+                check(factor == 0, "idle over budget not blanked", nled, budget_ma);
+            } else if(current_ma <= uint32_t(budget_ma)) {
+                check(factor == PowerLimiter::FACTOR_ONE or current_ma == uint32_t(budget_ma),
+                    "scaled below budget", nled, budget_ma);
+            } else {
+                // Scaled to within the budget, by the estimate and by the
+                // levels actually sent, and to within a few mA of it
+                check(factor < PowerLimiter::FACTOR_ONE, "not scaled over budget", nled, budget_ma);
+                uint32_t scaled_ma = limiter.current_ma(sums, nled, factor);
+                check(scaled_ma <= uint32_t(budget_ma) and scaled_ma + 2 >= uint32_t(budget_ma),
+                    "scaled estimate not at budget", nled, budget_ma);
+                std::vector<uint32_t> scaled = codes;
+                PowerLimiter::scale(scaled.data(), scaled.size(), factor);
+                check(limiter.current_ma(sum_levels(scaled), nled) <= uint32_t(budget_ma),
+                    "scaled frame over budget", nled, budget_ma);
+                bool same = true;
+                for(int i=0; i<nled; i++) {
+                    same = same and scaled[i] == PowerLimiter::scale(codes[i], factor);
+                }
+                check(same, "array and single code scaling differ", nled, budget_ma);
+            }
+
+            // A dark frame draws only the idle current, and is never scaled
+            // while the idle current is within the budget
+            std::vector<uint32_t> dark(nled, 0);
+            PowerLimiter::LevelSums dark_sums = sum_levels(dark);
+            check(limiter.current_ma(dark_sums, nled) == idle_ma, "dark frame current", nled, budget_ma);
+            check(idle_ma > uint32_t(budget_ma) or limiter.scale_factor(dark_sums, nled) == PowerLimiter::FACTOR_ONE,
+                "dark frame scaled", nled, budget_ma);
+        }
+    }
+
+    // Full white on 2048 WS2812 LEDs draws about 75 A
+    PowerLimiter limiter;
+    limiter.set_budget_ma(10000);
+    std::vector<uint32_t> white(2048, 0xFFFFFF00);
+    uint32_t white_ma = limiter.current_ma(sum_levels(white), white.size());
+    check(white_ma > 74000 and white_ma < 76000, "full white current", white.size(), 10000);
+
+    printf("%d checks, %d failed\n", ncase, nfail);
+    return nfail == 0 ? 0 : 1;
+}
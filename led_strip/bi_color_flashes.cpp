@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include "../common/build_date.hpp"
+#include "../common/pixel_code.hpp"
+
+#include "bi_color_flashes.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+
+    // Brightness of a flash in each frame after it starts, until it goes out.
+    // The sharp curve halves it every frame, the soft one every two. None
+    // may rise, a restarted flash relies on it.
+    struct FlashDecayCurve {
+        const char* name;
+        int nframe;
+        uint8_t level[16];
+    };
+
+    static constexpr FlashDecayCurve FLASH_DECAY_CURVES[] = {
+        { "sharp",   8, { 255, 127, 63, 31, 15, 7, 3, 1 } },
+        { "soft",   16, { 255, 180, 127, 90, 63, 45, 31, 22, 15, 11, 7, 5, 3, 2, 1, 1 } },
+        { "linear",  8, { 255, 223, 191, 159, 127, 95, 63, 31 } },
+    };
+
+    static_assert(sizeof(FLASH_DECAY_CURVES)/sizeof(FLASH_DECAY_CURVES[0]) == BiColorFlashes::NUM_DECAY_CURVES);
+}
+
+const char* BiColorFlashes::decay_curve_name(int decay)
+{
+    return FLASH_DECAY_CURVES[decay].name;
+}
+
+uint8_t BiColorFlashes::decay_curve_level(int decay, int age)
+{
+    const FlashDecayCurve& curve = FLASH_DECAY_CURVES[decay];
+    return age < curve.nframe ? curve.level[age] : 0;
+}
+
+void BiColorFlashes::set_probability(int flash_prob, int nled)
+{
+    if(nled != cached_nled_) {
+        // Drop the flashes past the end of the chain before resizing
+        for(int iflash=0; iflash<nflash_; ) {
+            if(flash_iled_[iflash] >= nled) {
+                flash_iled_[iflash] = flash_iled_[--nflash_];
+            } else {
+                ++iflash;
+            }
+        }
+        flash_iled_.resize(nled);
+        age_.resize(nled, NO_FLASH);
+    }
+    if(flash_prob == cached_flash_prob_ and nled == cached_nled_) {
+        return;
+    }
+
+    // Probability that at least one of the nled LEDs flashes, 1-(1-p)^nled,
+    // in units of 2^-31, with the power taken by squaring
+    constexpr uint64_t ONE = uint64_t(1)<<31;
+    uint64_t fp1 = ONE - (uint64_t(flash_prob)<<16);
+    uint64_t fpn = ONE;
+    for(unsigned n=nled; n>0; n>>=1) {
+        if(n & 1) {
+            fpn = (fpn * fp1)>>31;
+        }
+        fp1 = (fp1 * fp1)>>31;
+    }
+    non_flash_prob_ = ONE - fpn;
+
+    cached_flash_prob_ = flash_prob;
+    cached_nled_ = nled;
+}
+
+void BiColorFlashes::clear()
+{
+    for(int iflash=0; iflash<nflash_; iflash++) {
+        age_[flash_iled_[iflash]] = NO_FLASH;
+    }
+    nflash_ = 0;
+}
+
+void BiColorFlashes::generate(int decay)
+{
+    const FlashDecayCurve& curve = FLASH_DECAY_CURVES[decay];
+
+    // Age the live flashes, dropping those at the end of the curve, which
+    // may also have been shortened since they started
+    for(int iflash=0; iflash<nflash_; ) {
+        uint16_t iled = flash_iled_[iflash];
+        if(++age_[iled] >= curve.nframe) {
+            age_[iled] = NO_FLASH;
+            flash_iled_[iflash] = flash_iled_[--nflash_];
+        } else {
+            ++iflash;
+        }
+    }
+
+    uint32_t x = rng_();
+    for(int nflash=0; nflash<cached_nled_ and x<non_flash_prob_; ++nflash) {
+        int iled = rng_() % cached_nled_;
+        if(age_[iled] == NO_FLASH) {
+            flash_iled_[nflash_++] = iled;
+        }
+        age_[iled] = 0;
+        x = rng_();
+    }
+}
+
+void BiColorFlashes::apply(uint32_t* color_codes, int decay, uint32_t fr, uint32_t fg, uint32_t fb) const
+{
+    const FlashDecayCurve& curve = FLASH_DECAY_CURVES[decay];
+    for(int iflash=0; iflash<nflash_; iflash++) {
+        uint16_t iled = flash_iled_[iflash];
+        uint32_t w = curve.level[age_[iled]];
+        uint32_t r,g,b;
+        grbz_to_rgb(color_codes[iled], r, g, b);
+        r = std::max(r, (fr * w + 127) / 255);
+        g = std::max(g, (fg * w + 127) / 255);
+        b = std::max(b, (fb * w + 127) / 255);
+        color_codes[iled] = rgb_to_grbz(r, g, b);
+    }
+}
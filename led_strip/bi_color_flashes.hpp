@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <random>
+
+// Random flashes for the bi color menu, which start on random LEDs and fade
+// along a decay curve. Only the LEDs with a flash that is still lit are
+// visited, so the cost of a frame follows the number of flashes, not the
+// length of the chain.
+class BiColorFlashes {
+public:
+    static constexpr int NUM_DECAY_CURVES = 3;
+    static const char* decay_curve_name(int decay);
+    // Brightness of a flash age frames after it starts, 0 once it is out
+    static uint8_t decay_curve_level(int decay, int age);
+
+    // Recalculates the probability of a flash in a frame, and sizes the
+    // flash list to nled, only when flash_prob or nled change
+    void set_probability(int flash_prob, int nled);
+    void clear();
+
+    // Age the live flashes, dropping those that have gone out, and start
+    // this frame's
+    void generate(int decay);
+    // Brighten the LEDs with a flash towards the flash color
+    void apply(uint32_t* color_codes, int decay, uint32_t fr, uint32_t fg, uint32_t fb) const;
+
+    int nflash() const { return nflash_; }
+    uint32_t non_flash_prob() const { return non_flash_prob_; }
+
+private:
+    static constexpr uint8_t NO_FLASH = 0xFF;
+
+    // LEDs with a flash that is still lit, in no order, with the number of
+    // frames since the flash started on each LED (NO_FLASH if it has none).
+    // One is removed, by moving the last into its place, when it reaches the
+    // end of its decay curve. A new flash on an LED that is already lit
+    // restarts it, which shows the same as keeping both since the curves only
+    // fall, so the list never holds more than nled and no flash is dropped.
+    std::vector<uint16_t> flash_iled_;
+    std::vector<uint8_t> age_;
+    int nflash_ = 0;
+
+    // Probability that at least one LED flashes, in units of 2^-31
+    uint32_t non_flash_prob_ = 0;
+
+    // What non_flash_prob_ and the list were set up for
+    int cached_flash_prob_ = -1;
+    int cached_nled_ = 0;
+
+    std::minstd_rand rng_ { 123 };
+};
@@ -14,157 +14,76 @@
 
 namespace {
     static BuildDate build_date(__DATE__,__TIME__);
+
+    static const char* FLASH_COLOR_NAMES[] = { "white", "color 0", "color 1" };
 }
 
-BiColorMenu::BiColorMenu(SerialPIO& pio, SavedStateManager* saved_state_manager):
+BiColorMenu::BiColorMenu(OutputEngine& engine, SavedStateManager* saved_state_manager):
     SimpleItemValueMenu(make_menu_items(), "Bi color menu"),
-    pio_(pio), saved_state_manager_(saved_state_manager),
+    engine_(engine), pio_(engine.pio()), saved_state_manager_(saved_state_manager),
     c0_(*this, MIP_R, MIP_G, MIP_B, MIP_H, MIP_S, MIP_V),
-    c1_(*this, MIP_R, MIP_G, MIP_B, MIP_H, MIP_S, MIP_V),
-    rng_(123)
+    c1_(*this, MIP_R, MIP_G, MIP_B, MIP_H, MIP_S, MIP_V)
 {
     timer_interval_us_ = 50000; // 20Hz
     c0_.redraw(false);
-    update_calculations();
     presets_.emplace_back("none", std::vector<int32_t>{});
-    presets_.emplace_back("Jeanne", std::vector<int32_t>{55,5,5,0,4,6,30,60,96,24,15,1});
-    presets_.emplace_back("Flashes", std::vector<int32_t>{0,0,0,0,0,0,30,0,0,0,25,2});
+    presets_.emplace_back("Jeanne", std::vector<int32_t>{55,5,5,0,4,6,30,60,96,24,15,0,0,1});
+    presets_.emplace_back("Flashes", std::vector<int32_t>{0,0,0,0,0,0,30,0,0,0,25,0,0,2});
 }
 
-void BiColorMenu::update_calculations()
+void BiColorMenu::update_calculations(SerialPIO& pio)
 {
-    int p = period_;
-    if (p <= 0) p = 1; // avoid division by zero
-
-    // Convert hold_ and balance_ to 0..65535
-    int phase_frac = phase_ << (FRAC_BITS - 16);
-    int hold_frac = hold_ << (FRAC_BITS - 8);
-    int balance_frac = balance_ << (FRAC_BITS - 7);
-
-    // Calculate region lengths (scaled by 65536)
-    p_len_ = p << FRAC_BITS;
-    int hold_len = p * hold_frac;
-    trans_len_ = (p_len_ - 2 * hold_len) / 2;
-    if (trans_len_ < 0) trans_len_ = 0;
-
-    // Compute offset for balance
-    int dhold_len = int64_t(hold_len) * int64_t(balance_frac) >> FRAC_BITS;
-
-    // Apply phase
-    int phase_offset = phase_frac * p;
-
-    // Calculate the four region boundaries
-    up_start_    = (phase_offset + p_len_) % p_len_;
-    up_end_      = (up_start_ + trans_len_) % p_len_;
-    c1_hold_end_ = (up_end_ + hold_len + dhold_len + p_len_) % p_len_;
-    down_end_    = (c1_hold_end_ + trans_len_) % p_len_;
-
-    uint64_t fp1 = (1<<31) - (flash_prob_<<16);
-    uint64_t fpn = (1<<31);
-    for(int i=0; i<pio_.non(); i++) {
-        fpn = (fpn * fp1)>>31;
-    }
-    non_flash_prob_ = (1<<31) - fpn;
+    // Only the phase changes from frame to frame, the region lengths and the
+    // flash probability are recalculated when what they depend on changes
+    const Params& params = render_params_;
+    pattern_.set_colors(params.r0, params.g0, params.b0, params.r1, params.g1, params.b1);
+    pattern_.set_geometry(params.period, params.hold, params.balance);
+    pattern_.set_phase(phase_);
+    flashes_.set_probability(params.flash_prob, pio.non());
 }
 
-void BiColorMenu::generate_random_flashes()
+void BiColorMenu::generate_random_flashes(SerialPIO& pio)
 {
-    for(int i=0; i<pio_.non(); i++) {
-        flash_value_[i] >>= 1;
-    }
-    uint32_t x = rng_();
-    for(int nflash=0; nflash<pio_.non() and x<non_flash_prob_; ++nflash) {
-        int iled = rng_() % pio_.non();
-        flash_value_[iled] = 255;
-        x = rng_();
+    const Params& params = render_params_;
+    flashes_.generate(params.flash_decay);
+
+    uint32_t fr = 255, fg = 255, fb = 255;
+    if(params.flash_color == FLASH_COLOR_0) {
+        fr = params.r0; fg = params.g0; fb = params.b0;
+    } else if(params.flash_color == FLASH_COLOR_1) {
+        fr = params.r1; fg = params.g1; fb = params.b1;
     }
-    int iled0 = pio_.back() ? pio_.nled() - pio_.non() : 0;
-    for(int iled=0; iled<pio_.non(); iled++) {
-        uint32_t w = flash_value_[iled];
-        if(w > 0) {
-            uint32_t r,g,b;
-            grbz_to_rgb(color_codes_[iled0 + iled], r, g, b);
-            r = std::max(r, w);
-            g = std::max(g, w);
-            b = std::max(b, w);
-            color_codes_[iled0 + iled] = rgb_to_grbz(r, g, b);
-        }
-    }
-}
-
-uint32_t BiColorMenu::color_code(int iled, bool debug)
-{
-    // Map iled into the period
-    int idx = (iled<<FRAC_BITS) % p_len_;
-
-    int r, g, b;
-
-    if ((up_start_ <= up_end_ && idx >= up_start_ && idx < up_end_) ||
-               (up_start_ > up_end_ && (idx >= up_start_ || idx < up_end_))) {
-        // c0 -> c1 (blend)
-        int rel = (idx - up_start_ + p_len_) % p_len_;
-        int t_fixed = (int64_t(rel)<<FRAC_BITS) / int64_t(trans_len_);
-        // printf("%3d: %d %d %d\n", iled, idx, rel, t_fixed);
-
-        r = (c0_.r() * (FRAC_ONE - t_fixed) + c1_.r() * t_fixed) >> FRAC_BITS;
-        g = (c0_.g() * (FRAC_ONE - t_fixed) + c1_.g() * t_fixed) >> FRAC_BITS;
-        b = (c0_.b() * (FRAC_ONE - t_fixed) + c1_.b() * t_fixed) >> FRAC_BITS;
-    } else if ((up_end_ <= c1_hold_end_ && idx >= up_end_ && idx < c1_hold_end_) ||
-               (up_end_ > c1_hold_end_ && (idx >= up_end_ || idx < c1_hold_end_))) {
-        // hold at c1 (saturation)
-        r = c1_.r();
-        g = c1_.g();
-        b = c1_.b();
-    } else if ((c1_hold_end_ <= down_end_ && idx >= c1_hold_end_ && idx < down_end_) ||
-               (c1_hold_end_ > down_end_ && (idx >= c1_hold_end_ || idx < down_end_))) {
-        // c1 -> c0 (blend)
-        int rel = (idx - c1_hold_end_ + p_len_) % p_len_;
-        int t_fixed = FRAC_ONE - (int64_t(rel)<<FRAC_BITS) / int64_t(trans_len_);
-        r = (c0_.r() * (FRAC_ONE - t_fixed) + c1_.r() * t_fixed) >> FRAC_BITS;
-        g = (c0_.g() * (FRAC_ONE - t_fixed) + c1_.g() * t_fixed) >> FRAC_BITS;
-        b = (c0_.b() * (FRAC_ONE - t_fixed) + c1_.b() * t_fixed) >> FRAC_BITS;
-    } else {
-        // hold at c0 (saturation)
-        r = c0_.r();
-        g = c0_.g();
-        b = c0_.b();
-    }
-
-    if(debug) {
-        printf("%3d: %3d %3d %3d\n", iled, r, g, b);
-    }
-
-    return rgb_to_grbz(r, g, b);
+    flashes_.apply(pio.back_buffer().data(), params.flash_decay, fr, fg, fb);
 }
 
-void BiColorMenu::send_color_string(bool flash)
+void BiColorMenu::send_color_string(SerialPIO& pio, bool flash)
 {
     // puts("Sending color string .....");
 
-    if(pio_.back()) {
-        int nperiod = std::min(pio_.non(), period_);
-        for(int iled=0, jled=pio_.nled(); iled<nperiod; iled++) {
-            color_codes_[--jled] = color_code(iled);
+    // Render into the back buffer while the previous frame is transmitted
+    std::vector<uint32_t>& color_codes = pio.back_buffer();
+
+    if(pio.back()) {
+        int nperiod = std::min(pio.non(), render_params_.period);
+        if(nperiod > 0) {
+            pattern_.render_period(&color_codes[pio.non()-1], -1, nperiod);
         }
-        for(int iled=nperiod, jled=pio_.nled()-nperiod, kled=pio_.nled(); iled<pio_.non(); iled++) {
-            color_codes_[--jled] = color_codes_[--kled];
+        for(int iled=nperiod, jled=pio.non()-nperiod, kled=pio.non(); iled<pio.non(); iled++) {
+            color_codes[--jled] = color_codes[--kled];
         }
     } else {
-        int nperiod = std::min(pio_.non(), period_);
-        for(int iled=0; iled<nperiod; iled++) {
-            color_codes_[iled] = color_code(iled);
-        }
-        for(int iled=nperiod, jled=0; iled<pio_.non(); iled++,jled++) {
-            color_codes_[iled] = color_codes_[jled];
+        int nperiod = std::min(pio.non(), render_params_.period);
+        pattern_.render_period(color_codes.data(), 1, nperiod);
+        for(int iled=nperiod, jled=0; iled<pio.non(); iled++,jled++) {
+            color_codes[iled] = color_codes[jled];
         }
     }
 
     if(flash) {
-        generate_random_flashes();
+        generate_random_flashes(pio);
     }
 
-    pio_.put_pixel_vector(color_codes_);
-    pio_.flush();
+    pio.send_frame();
     // puts("..... color string sent");
 }
 
@@ -181,6 +100,8 @@ std::vector<SimpleItemValueMenu::MenuItem> BiColorMenu::make_menu_items()
     menu_items.at(MIP_BALANCE)     = {"</w/>   : Decrease/Set/Increase balance (-128..128)", 4, "0"};
     menu_items.at(MIP_SPEED)       = {"Left/Right/z : Decrease/Increase/Zero speed", 3, "0"};
     menu_items.at(MIP_FLASH_PROB)  = {"Down/Up/0 : Decrease/Increase/Zero flash probability", 3, "0"};
+    menu_items.at(MIP_FLASH_DECAY) = {"f       : Cycle flash decay curve", 6, "sharp"};
+    menu_items.at(MIP_FLASH_COLOR) = {"c       : Cycle flash color", 7, "white"};
     menu_items.at(MIP_PRESET)      = {"@       : Cycle through preset configurations", 8, "none"};
     menu_items.at(MIP_WRITE_STATE) = {"Ctrl-w  : Write state to flash", 0, ""};
     menu_items.at(MIP_EXIT)        = {"q       : Exit menu", 0, ""};
@@ -224,6 +145,18 @@ void BiColorMenu::set_flash_prob_value(bool draw)
     if(draw)draw_item_value(MIP_FLASH_PROB);
 }
 
+void BiColorMenu::set_flash_decay_value(bool draw)
+{
+    menu_items_[MIP_FLASH_DECAY].value = BiColorFlashes::decay_curve_name(flash_decay_);
+    if(draw)draw_item_value(MIP_FLASH_DECAY);
+}
+
+void BiColorMenu::set_flash_color_value(bool draw)
+{
+    menu_items_[MIP_FLASH_COLOR].value = FLASH_COLOR_NAMES[flash_color_];
+    if(draw)draw_item_value(MIP_FLASH_COLOR);
+}
+
 void BiColorMenu::set_preset_value(bool draw)
 {
     menu_items_[MIP_PRESET].value = presets_[preset_].name;
@@ -238,22 +171,136 @@ void BiColorMenu::set_no_preset(bool draw)
     }
 }
 
+void BiColorMenu::publish_params()
+{
+    Params params;
+    params.r0 = c0_.r();
+    params.g0 = c0_.g();
+    params.b0 = c0_.b();
+    params.r1 = c1_.r();
+    params.g1 = c1_.g();
+    params.b1 = c1_.b();
+    params.period = period_;
+    params.hold = hold_;
+    params.balance = balance_;
+    params.speed = speed_;
+    params.flash_prob = flash_prob_;
+    params.flash_decay = flash_decay_;
+    params.flash_color = flash_color_;
+    params_.publish(params);
+}
+
 bool BiColorMenu::event_loop_starting(int& return_code)
 {
-    color_codes_.resize(pio_.nled());
-    flash_value_.resize(pio_.nled());
-    color_codes_.assign(pio_.nled(), 0);
-    flash_value_.assign(pio_.nled(), 0);
-    pio_.activate_program();
-    send_color_string();
+    publish_params();
+    engine_.start(this, FRAME_INTERVAL_US);
     return true;
 }
 
 void BiColorMenu::event_loop_finishing(int& return_code)
 {
-    pio_.put_pixel(0, pio_.nled());
-    pio_.flush();
-    pio_.deactivate_program();
+    engine_.stop();
+}
+
+void BiColorMenu::output_starting(SerialPIO& pio)
+{
+    flashes_.clear();
+    scroll_period_.clear();
+}
+
+void BiColorMenu::generate_frame(SerialPIO& pio, uint32_t tick)
+{
+    params_.fetch(render_params_);
+    if(tick != 0) {
+        phase_ = (phase_ + (render_params_.speed<<6)) % 65536;
+    }
+    if(can_scroll(pio)) {
+        send_scrolled_period(pio);
+        return;
+    }
+    update_calculations(pio);
+    send_color_string(pio, tick != 0);
+}
+
+bool BiColorMenu::can_scroll(SerialPIO& pio) const
+{
+    // Only worth it if the period repeats along the chain, and the ring
+    // frames are not dithered, so leave that to the full render
+    return SerialPIO::ring_period_supported(render_params_.period)
+        and render_params_.period < pio.non() and not pio.dither()
+        and render_params_.flash_prob == 0 and flashes_.nflash() == 0;
+}
+
+void BiColorMenu::send_scrolled_period(SerialPIO& pio)
+{
+    const Params& params = render_params_;
+    const int p = params.period;
+
+    if(int(scroll_period_.size()) != p or pio.back() != scroll_back_
+            or params.r0 != scroll_params_.r0 or params.g0 != scroll_params_.g0
+            or params.b0 != scroll_params_.b0 or params.r1 != scroll_params_.r1
+            or params.g1 != scroll_params_.g1 or params.b1 != scroll_params_.b1
+            or params.hold != scroll_params_.hold or params.balance != scroll_params_.balance) {
+        update_calculations(pio);
+        pattern_.set_phase(0);
+        scroll_period_.resize(p);
+        pattern_.render_period(scroll_period_.data(), 1, p);
+        scroll_params_ = params;
+        scroll_back_ = pio.back();
+        scroll_blend_ = -1;
+    }
+
+    // The pattern moves up the chain by phase_*p/65536 LEDs, a whole number
+    // of which are taken by moving the start of the ring, and the fraction by
+    // blending each LED with the one before it. The blend, and the commit of
+    // the ring, are redone whenever the fraction changes, which at most
+    // speeds is every frame : that costs O(p) a frame, against O(non) for
+    // the full render, with p < non (bench_bi_color_pattern).
+    uint32_t phase_offset = uint32_t(phase_) * p;
+    int shift = phase_offset >> BiColorPattern::FRAC_BITS;
+    int blend = (phase_offset >> (BiColorPattern::FRAC_BITS - 8)) & 0xFF;
+
+    if(blend != scroll_blend_ or int(pio.ring_nperiod()) != p) {
+        // In back mode the chain runs from the end, so the period does too
+        std::vector<uint32_t>& ring = pio.ring_buffer(p);
+        BiColorPattern::blend_period(scroll_period_.data(), ring.data(), p, blend, pio.back());
+        pio.commit_ring();
+        scroll_blend_ = blend;
+    }
+
+    unsigned start = pio.back() ? unsigned(shift - pio.non()) : unsigned(p - shift);
+    pio.send_ring_frame(start & (p - 1));
+}
+
+void BiColorMenu::process_command(SerialPIO& pio, int command)
+{
+    switch(command) {
+    case CMD_DEBUG_DUMP:
+        // Printed from here since the calculations belong to core 1, this
+        // delays the frame, but only when asked for
+        print_calculations(pio);
+        printf("frames = %lu  missed = %lu  max_late_us = %lu\n",
+            (unsigned long)engine_.frame_count(), (unsigned long)engine_.missed_frame_count(),
+            (unsigned long)engine_.max_late_us());
+        break;
+    }
+}
+
+void BiColorMenu::print_calculations(SerialPIO& pio)
+{
+    // Check the incremental renderer against the direct calculation
+    std::vector<uint32_t> rendered(pio.non());
+    pattern_.render_period(rendered.data(), 1, rendered.size());
+    int nmismatch = 0;
+    for(int iled=0; iled<pio.non(); iled++) {
+        if(pattern_.color_code(iled, true) != rendered[iled]) {
+            ++nmismatch;
+        }
+    }
+    printf("render mismatches = %d\n", nmismatch);
+    pattern_.print_calculations();
+    printf("non_flash_prob = %u\n", flashes_.non_flash_prob());
+    printf("flashes = %d\n", flashes_.nflash());
 }
 
 bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
@@ -268,7 +315,7 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
     if(c->process_key_press(key, key_count, changed)) {
         if(changed) {
             set_no_preset();
-            send_color_string();
+            publish_params();
         }
         return true;
     }
@@ -284,24 +331,21 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
         if(increase_value_in_range(period_, 2*pio_.non(), (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_period_value();
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         break;
     case '-':
         if(decrease_value_in_range(period_, 2, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_period_value();
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         break; 
     case 'p':
     case 'P':
         if(InplaceInputMenu::input_value_in_range(period_, 2, 2*pio_.non(), this, MIP_PERIOD, 5)) {
-            update_calculations();
             set_no_preset();
-            send_color_string();
+            publish_params();
         }
         set_period_value();
         break;
@@ -310,24 +354,21 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
         if(increase_value_in_range(hold_, 127, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_hold_value();
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         break;
     case '[':
         if(decrease_value_in_range(hold_, 0, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_hold_value();
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         break; 
     case 'm':
     case 'M':
         if(InplaceInputMenu::input_value_in_range(hold_, 0, 127, this, MIP_HOLD, 3)) {
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         set_hold_value();
         break;
@@ -336,24 +377,21 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
         if(increase_value_in_range(balance_, 128, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_balance_value();
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         break;
     case '<':
         if(decrease_value_in_range(balance_, -128, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_balance_value();
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         break; 
     case 'w':
     case 'W':
         if(InplaceInputMenu::input_value_in_range(balance_, -128, 128, this, MIP_BALANCE, 4)) {
             set_no_preset();
-            update_calculations();
-            send_color_string();
+            publish_params();
         }
         set_balance_value();
         break;
@@ -362,14 +400,14 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
         if(increase_value_in_range(speed_, 256, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_speed_value();
             set_no_preset();
-            send_color_string();
+            publish_params();
         }
         break;
     case KEY_LEFT:
         if(decrease_value_in_range(speed_, -256, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_speed_value();
             set_no_preset();
-            send_color_string();
+            publish_params();
         }
         break;
     case 'z':
@@ -378,6 +416,7 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
             speed_ = 0;
             set_speed_value();
             set_no_preset();
+            publish_params();
         }
         break;
 
@@ -385,12 +424,14 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
         if(increase_value_in_range(flash_prob_, 256, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_flash_prob_value();
             set_no_preset();
+            publish_params();
         }
         break;
     case KEY_DOWN:
         if(decrease_value_in_range(flash_prob_, 0, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_flash_prob_value();
             set_no_preset();
+            publish_params();
         }
         break;
     case '0':
@@ -398,9 +439,25 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
             flash_prob_ = 0;
             set_no_preset();
             set_flash_prob_value();
+            publish_params();
         }
         break;
 
+    case 'f':
+    case 'F':
+        flash_decay_ = (flash_decay_ + 1) % NUM_FLASH_DECAYS;
+        set_flash_decay_value();
+        set_no_preset();
+        publish_params();
+        break;
+    case 'c':
+    case 'C':
+        flash_color_ = (flash_color_ + 1) % NUM_FLASH_COLORS;
+        set_flash_color_value();
+        set_no_preset();
+        publish_params();
+        break;
+
     case '@':
         if(preset_ == 0) {
             presets_[preset_].state = get_saved_state();
@@ -411,12 +468,12 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
         }        
         set_preset_value();
         do_set_saved_state(presets_[preset_].state, true);
-        send_color_string();
+        publish_params();
         break;
 
     case 23:
         if(saved_state_manager_) {
-            saved_state_manager_->save_state();
+            saved_state_manager_->save_state(true);
             PopupMenu pm("State written to flash", 2, true, this, "Information");
             pm.event_loop();
             this->redraw();
@@ -429,16 +486,7 @@ bool BiColorMenu::process_key_press(int key, int key_count, int& return_code,
         return false;
 
     case 'D':
-        for(int iled=0; iled<pio_.non(); iled++) {
-            color_code(iled, true);
-        }
-        printf("p_len = %d\n", p_len_);
-        printf("trans_len = %d\n", trans_len_);
-        printf("up_start = %d\n", up_start_);
-        printf("up_end = %d\n", up_end_);
-        printf("c1_hold_end = %d\n", c1_hold_end_);
-        printf("down_end = %d\n", down_end_);   
-        printf("non_flash_prob = %d\n", non_flash_prob_);
+        engine_.send_command(CMD_DEBUG_DUMP);
         break;
 
     default:
@@ -460,11 +508,6 @@ bool BiColorMenu::process_timer(bool controller_is_connected, int& return_code,
         }
         heartbeat_timer_count_ = 0;
     }
-
-    phase_ = (phase_ + (speed_<<6)) % 65536;
-    update_calculations();
-    send_color_string(true);
-
     return true;
 }
 
@@ -482,6 +525,8 @@ std::vector<int32_t> BiColorMenu::get_saved_state()
     state.push_back(balance_);
     state.push_back(speed_);
     state.push_back(flash_prob_);
+    state.push_back(flash_decay_);
+    state.push_back(flash_color_);
     state.push_back(preset_);
     return state;
 }
@@ -491,9 +536,26 @@ bool BiColorMenu::set_saved_state(const std::vector<int32_t>& state)
     return do_set_saved_state(state, false);
 }
 
+bool BiColorMenu::set_old_saved_state(int32_t version, const std::vector<int32_t>& state)
+{
+    // Version 0 had no flash decay or color, insert the defaults before the
+    // preset, which stays last
+    if(version != 0 or state.size() != 12) {
+        return false;
+    }
+    std::vector<int32_t> new_state(state.begin(), state.begin() + 11);
+    new_state.push_back(FLASH_DECAY_SHARP);
+    new_state.push_back(FLASH_WHITE);
+    new_state.push_back(state[11]);
+    return do_set_saved_state(new_state, false);
+}
+
 bool BiColorMenu::do_set_saved_state(const std::vector<int32_t>& state, bool redraw)
 {
-    if(state.size() != 12) {
+    if(state.size() != 14) {
+        return false;
+    }
+    if(state[11] < 0 or state[11] >= NUM_FLASH_DECAYS or state[12] < 0 or state[12] >= NUM_FLASH_COLORS) {
         return false;
     }
     if(cset_ == 0) {
@@ -508,20 +570,23 @@ bool BiColorMenu::do_set_saved_state(const std::vector<int32_t>& state, bool red
     balance_ = state[8];
     speed_ = state[9];
     flash_prob_ = state[10];
-    preset_ = state[11];
+    flash_decay_ = state[11];
+    flash_color_ = state[12];
+    preset_ = state[13];
     set_period_value(redraw);
     set_hold_value(redraw);
     set_balance_value(redraw);
     set_speed_value(redraw);
     set_flash_prob_value(redraw);
+    set_flash_decay_value(redraw);
+    set_flash_color_value(redraw);
     set_preset_value(redraw);
-    update_calculations();
     return true;
 }
 
 int32_t BiColorMenu::get_version()
 {
-    return 0;
+    return 1;
 }
 
 int32_t BiColorMenu::get_supplier_id()
@@ -9,10 +9,15 @@
 #include "../common/menu.hpp"
 #include "../common/color_led.hpp"
 #include "../common/saved_state.hpp"
+#include "../common/output_engine.hpp"
 
-class BiColorMenu: public SimpleItemValueMenu, public SavedStateSupplierConsumer {
+#include "bi_color_pattern.hpp"
+#include "bi_color_flashes.hpp"
+
+class BiColorMenu: public SimpleItemValueMenu, public SavedStateSupplierConsumer,
+                   public FrameGenerator {
 public:
-    BiColorMenu(SerialPIO& pio_, SavedStateManager* saved_state_manager = nullptr);
+    BiColorMenu(OutputEngine& engine, SavedStateManager* saved_state_manager = nullptr);
     virtual ~BiColorMenu() { }
     bool event_loop_starting(int& return_code) final;
     void event_loop_finishing(int& return_code) final;
@@ -22,10 +27,20 @@ public:
 
     std::vector<int32_t> get_saved_state() override;
     bool set_saved_state(const std::vector<int32_t>& state) override;
+    bool set_old_saved_state(int32_t version, const std::vector<int32_t>& state) override;
     int32_t get_version() override;
     int32_t get_supplier_id() override;
-    
+
+    void output_starting(SerialPIO& pio) override;
+    void process_command(SerialPIO& pio, int command) override;
+    void generate_frame(SerialPIO& pio, uint32_t tick) override;
+
 private:
+    // Commands sent to the generator on core 1
+    enum Command {
+        CMD_DEBUG_DUMP
+    };
+
     enum MenuItemPositions {
         MIP_SWITCH,
         MIP_R,
@@ -39,6 +54,8 @@ private:
         MIP_BALANCE,
         MIP_SPEED,
         MIP_FLASH_PROB,
+        MIP_FLASH_DECAY,
+        MIP_FLASH_COLOR,
         MIP_PRESET,
         MIP_WRITE_STATE,
         MIP_EXIT,
@@ -53,16 +70,42 @@ private:
     void set_balance_value(bool draw = true);
     void set_speed_value(bool draw = true);
     void set_flash_prob_value(bool draw = true);
+    void set_flash_decay_value(bool draw = true);
+    void set_flash_color_value(bool draw = true);
     void set_preset_value(bool draw = true);
     
     void set_no_preset(bool draw = true);
 
-    void generate_random_flashes();
-    uint32_t color_code(int iled, bool debug = false);
-    void send_color_string(bool flash = false);
+    void publish_params();
+
+    void generate_random_flashes(SerialPIO& pio);
+    void send_color_string(SerialPIO& pio, bool flash = false);
+    bool can_scroll(SerialPIO& pio) const;
+    void send_scrolled_period(SerialPIO& pio);
+    void print_calculations(SerialPIO& pio);
 
     bool do_set_saved_state(const std::vector<int32_t>& state, bool redraw);
 
+    static constexpr uint32_t FRAME_INTERVAL_US = 50000; // 20Hz
+
+    // How the brightness of a flash falls off from frame to frame, and what
+    // color it flashes to
+    enum FlashDecay {
+        FLASH_DECAY_SHARP,
+        FLASH_DECAY_SOFT,
+        FLASH_DECAY_LINEAR,
+        NUM_FLASH_DECAYS // MUST BE LAST ITEM IN LIST
+    };
+    static_assert(NUM_FLASH_DECAYS == BiColorFlashes::NUM_DECAY_CURVES);
+
+    enum FlashColor {
+        FLASH_WHITE,
+        FLASH_COLOR_0,
+        FLASH_COLOR_1,
+        NUM_FLASH_COLORS // MUST BE LAST ITEM IN LIST
+    };
+
+    OutputEngine& engine_;
     SerialPIO& pio_;
     SavedStateManager* saved_state_manager_ = nullptr;
     
@@ -74,13 +117,12 @@ private:
     int hold_ = 0;
     int balance_ = 0;
     int speed_ = 0;
-    int phase_ = 0;
     int flash_prob_ = 0;
+    int flash_decay_ = FLASH_DECAY_SHARP;
+    int flash_color_ = FLASH_WHITE;
     int preset_ = 0;
 
     int heartbeat_timer_count_ = 0;
-    std::vector<uint32_t> color_codes_;
-    std::vector<int> flash_value_;
 
     struct Preset {
         Preset(const std::string& n, const std::vector<int32_t>& s): name(n), state(s) {}
@@ -90,19 +132,37 @@ private:
 
     std::vector<Preset> presets_;
 
-    // All calculations in integer math, using 0..65535 for fractions
-    static constexpr int FRAC_BITS = 16;
-    static constexpr int FRAC_ONE = 1 << FRAC_BITS;
+    struct Params {
+        int r0, g0, b0;
+        int r1, g1, b1;
+        int period;
+        int hold;
+        int balance;
+        int speed;
+        int flash_prob;
+        int flash_decay;
+        int flash_color;
+    };
+    SharedParams<Params> params_;
+
+    // Render state, only touched on core 1
+    Params render_params_ = { };
+    int phase_ = 0;
+
+    void update_calculations(SerialPIO& pio);
 
-    void update_calculations();
+    BiColorPattern pattern_;
+    BiColorFlashes flashes_;
 
-    int p_len_;
-    int trans_len_;
-    int up_start_;
-    int up_end_;
-    int c1_hold_end_;
-    int down_end_;
-    uint32_t non_flash_prob_ = 0;
+    // Scrolling : when the period is a power of two it is rendered at zero
+    // phase into scroll_period_ only when the pattern changes, and each frame
+    // sends it from a ring buffer in the PIO, starting at the whole number of
+    // LEDs of the phase, after blending it with its neighbour by the fraction
+    // (scroll_blend_, in 256ths), which is only redone when that changes.
+    // Flashes must have died away.
+    std::vector<uint32_t> scroll_period_;
+    Params scroll_params_ = { };
+    bool scroll_back_ = false;
+    int scroll_blend_ = -1;
 
-    std::minstd_rand rng_;
 };
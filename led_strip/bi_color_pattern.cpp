@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "../common/build_date.hpp"
+#include "../common/pixel_code.hpp"
+
+#include "bi_color_pattern.hpp"
+
+namespace {
+    static BuildDate build_date(__DATE__,__TIME__);
+}
+
+void BiColorPattern::set_colors(int r0, int g0, int b0, int r1, int g1, int b1)
+{
+    r0_ = r0;
+    g0_ = g0;
+    b0_ = b0;
+    r1_ = r1;
+    g1_ = g1;
+    b1_ = b1;
+}
+
+void BiColorPattern::set_geometry(int period, int hold, int balance)
+{
+    if(period == geometry_period_ and hold == geometry_hold_ and balance == geometry_balance_) {
+        return;
+    }
+
+    int p = period;
+    if (p <= 0) p = 1; // avoid division by zero
+
+    // Convert hold_ and balance_ to 0..65535
+    int hold_frac = hold << (FRAC_BITS - 8);
+    int balance_frac = balance << (FRAC_BITS - 7);
+
+    // Calculate region lengths (scaled by 65536)
+    p_len_ = p << FRAC_BITS;
+    hold_len_ = p * hold_frac;
+    trans_len_ = (p_len_ - 2 * hold_len_) / 2;
+    if (trans_len_ < 0) trans_len_ = 0;
+
+    // Compute offset for balance
+    dhold_len_ = int64_t(hold_len_) * int64_t(balance_frac) >> FRAC_BITS;
+
+    // The boundaries relative to up_start_ do not depend on the phase
+    up_end_offset_      = trans_len_ % p_len_;
+    c1_hold_end_offset_ = up_end_offset_ + (hold_len_ + dhold_len_ + p_len_) % p_len_;
+    down_end_offset_    = c1_hold_end_offset_ + trans_len_ % p_len_;
+    t_step_     = (uint64_t(FRAC_ONE) << FRAC_BITS) / uint64_t(trans_len_);
+    t_step_rem_ = (uint64_t(FRAC_ONE) << FRAC_BITS) % uint64_t(trans_len_);
+
+    geometry_period_ = period;
+    geometry_hold_ = hold;
+    geometry_balance_ = balance;
+}
+
+void BiColorPattern::set_phase(int phase)
+{
+    // Apply phase
+    int phase_frac = phase << (FRAC_BITS - 16);
+    int phase_offset = phase_frac * (p_len_ >> FRAC_BITS);
+
+    // Calculate the four region boundaries
+    up_start_    = (phase_offset + p_len_) % p_len_;
+    up_end_      = (up_start_ + trans_len_) % p_len_;
+    c1_hold_end_ = (up_end_ + hold_len_ + dhold_len_ + p_len_) % p_len_;
+    down_end_    = (c1_hold_end_ + trans_len_) % p_len_;
+}
+
+uint32_t BiColorPattern::color_code(int iled, bool debug) const
+{
+    // Map iled into the period
+    int idx = (iled<<FRAC_BITS) % p_len_;
+
+    int r, g, b;
+
+    if ((up_start_ <= up_end_ && idx >= up_start_ && idx < up_end_) ||
+               (up_start_ > up_end_ && (idx >= up_start_ || idx < up_end_))) {
+        // c0 -> c1 (blend)
+        int rel = (idx - up_start_ + p_len_) % p_len_;
+        int t_fixed = (int64_t(rel)<<FRAC_BITS) / int64_t(trans_len_);
+        // printf("%3d: %d %d %d\n", iled, idx, rel, t_fixed);
+
+        r = (r0_ * (FRAC_ONE - t_fixed) + r1_ * t_fixed) >> FRAC_BITS;
+        g = (g0_ * (FRAC_ONE - t_fixed) + g1_ * t_fixed) >> FRAC_BITS;
+        b = (b0_ * (FRAC_ONE - t_fixed) + b1_ * t_fixed) >> FRAC_BITS;
+    } else if ((up_end_ <= c1_hold_end_ && idx >= up_end_ && idx < c1_hold_end_) ||
+               (up_end_ > c1_hold_end_ && (idx >= up_end_ || idx < c1_hold_end_))) {
+        // hold at c1 (saturation)
+        r = r1_;
+        g = g1_;
+        b = b1_;
+    } else if ((c1_hold_end_ <= down_end_ && idx >= c1_hold_end_ && idx < down_end_) ||
+               (c1_hold_end_ > down_end_ && (idx >= c1_hold_end_ || idx < down_end_))) {
+        // c1 -> c0 (blend)
+        int rel = (idx - c1_hold_end_ + p_len_) % p_len_;
+        int t_fixed = FRAC_ONE - (int64_t(rel)<<FRAC_BITS) / int64_t(trans_len_);
+        r = (r0_ * (FRAC_ONE - t_fixed) + r1_ * t_fixed) >> FRAC_BITS;
+        g = (g0_ * (FRAC_ONE - t_fixed) + g1_ * t_fixed) >> FRAC_BITS;
+        b = (b0_ * (FRAC_ONE - t_fixed) + b1_ * t_fixed) >> FRAC_BITS;
+    } else {
+        // hold at c0 (saturation)
+        r = r0_;
+        g = g0_;
+        b = b0_;
+    }
+
+    if(debug) {
+        printf("%3d: %3d %3d %3d\n", iled, r, g, b);
+    }
+
+    return rgb_to_grbz(r, g, b);
+}
+
+void BiColorPattern::render_period(uint32_t* color_codes, int step, int nled) const
+{
+    // Walk the regions in order from the position of the first LED relative
+    // to up_start_. Each run of LEDs in a region is counted with a shift, and
+    // the blend fraction is stepped with its remainder, so only entering a
+    // blend needs a division.
+    const uint32_t c0_code = rgb_to_grbz(r0_, g0_, b0_);
+    const uint32_t c1_code = rgb_to_grbz(r1_, g1_, b1_);
+    const int dr = r1_ - r0_;
+    const int dg = g1_ - g0_;
+    const int db = b1_ - b0_;
+
+    int offset = (p_len_ - up_start_) % p_len_;
+    while(nled > 0) {
+        // 0 : c0 -> c1, 1 : hold at c1, 2 : c1 -> c0, 3 : hold at c0
+        int region = 3;
+        int region_start = down_end_offset_;
+        int region_end = p_len_;
+        if(offset < up_end_offset_) {
+            region = 0;
+            region_start = 0;
+            region_end = up_end_offset_;
+        } else if(offset < c1_hold_end_offset_) {
+            region = 1;
+            region_start = up_end_offset_;
+            region_end = c1_hold_end_offset_;
+        } else if(offset < down_end_offset_) {
+            region = 2;
+            region_start = c1_hold_end_offset_;
+            region_end = down_end_offset_;
+        }
+        int nrun = std::min(nled, (region_end - offset + FRAC_ONE - 1) >> FRAC_BITS);
+        nled -= nrun;
+
+        if(region == 1 or region == 3) {
+            uint32_t code = (region == 1) ? c1_code : c0_code;
+            for(int i=0; i<nrun; i++, color_codes+=step) {
+                *color_codes = code;
+            }
+        } else {
+            int64_t rel = int64_t(offset - region_start) << FRAC_BITS;
+            uint32_t t = rel / trans_len_;
+            uint32_t t_rem = rel % trans_len_;
+            for(int i=0; i<nrun; i++, color_codes+=step) {
+                int t_fixed = (region == 2) ? FRAC_ONE - int(t) : int(t);
+                int r = ((r0_ << FRAC_BITS) + dr * t_fixed) >> FRAC_BITS;
+                int g = ((g0_ << FRAC_BITS) + dg * t_fixed) >> FRAC_BITS;
+                int b = ((b0_ << FRAC_BITS) + db * t_fixed) >> FRAC_BITS;
+                *color_codes = rgb_to_grbz(r, g, b);
+                t += t_step_;
+                t_rem += t_step_rem_;
+                if(t_rem >= uint32_t(trans_len_)) {
+                    t_rem -= trans_len_;
+                    ++t;
+                }
+            }
+        }
+
+        offset += nrun << FRAC_BITS;
+        if(offset >= p_len_) {
+            offset -= p_len_;
+        }
+    }
+}
+
+void BiColorPattern::blend_period(const uint32_t* period, uint32_t* color_codes, int p, int blend,
+    bool reverse)
+{
+    for(int j=0; j<p; j++) {
+        uint32_t a = period[j];
+        uint32_t b = period[(j + p - 1) & (p - 1)];
+        uint32_t code = 0;
+        for(int bit=8; bit<32; bit+=8) {
+            uint32_t ca = (a >> bit) & 0xFF;
+            uint32_t cb = (b >> bit) & 0xFF;
+            code |= ((ca * (256 - blend) + cb * blend) >> 8) << bit;
+        }
+        color_codes[reverse ? p - 1 - j : j] = code;
+    }
+}
+
+void BiColorPattern::print_calculations() const
+{
+    printf("p_len = %d\n", p_len_);
+    printf("trans_len = %d\n", trans_len_);
+    printf("up_start = %d\n", up_start_);
+    printf("up_end = %d\n", up_end_);
+    printf("c1_hold_end = %d\n", c1_hold_end_);
+    printf("down_end = %d\n", down_end_);
+}
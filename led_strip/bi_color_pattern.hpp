@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+// The pattern of the bi color menu, repeating every period LEDs : a blend
+// from color 0 to color 1, a hold at color 1, a blend back to color 0 and a
+// hold at color 0. The holds take hold/256 of the period each, balance (from
+// -128 to 128) moves time from the color 0 hold to the color 1 hold, and the
+// pattern is moved up the chain by phase/65536 of the period. All
+// calculations in integer math, using 0..65535 for fractions.
+class BiColorPattern {
+public:
+    static constexpr int FRAC_BITS = 16;
+    static constexpr int FRAC_ONE = 1 << FRAC_BITS;
+
+    void set_colors(int r0, int g0, int b0, int r1, int g1, int b1);
+    // The region lengths are only recalculated when these change, the phase
+    // must be set after them
+    void set_geometry(int period, int hold, int balance);
+    void set_phase(int phase);
+
+    // Color of LED iled, calculated on its own (and printed if debug is set)
+    uint32_t color_code(int iled, bool debug = false) const;
+    // Same colors as color_code(0) to color_code(nled-1), written every step
+    // words, calculated incrementally
+    void render_period(uint32_t* color_codes, int step, int nled) const;
+
+    // A period of p (a power of two) colors moved up by blend/256 of an LED,
+    // by blending each with the one before it, written in reverse if asked
+    static void blend_period(const uint32_t* period, uint32_t* color_codes, int p, int blend,
+        bool reverse = false);
+
+    void print_calculations() const;
+
+private:
+    int r0_ = 0, g0_ = 0, b0_ = 0;
+    int r1_ = 0, g1_ = 0, b1_ = 0;
+
+    int p_len_;
+    int trans_len_;
+    int hold_len_;
+    int dhold_len_;
+    int up_start_;
+    int up_end_;
+    int c1_hold_end_;
+    int down_end_;
+
+    // What the region lengths were calculated for
+    int geometry_period_ = -1;
+    int geometry_hold_ = -1;
+    int geometry_balance_ = -1;
+
+    // The same boundaries as offsets from up_start_, so that the regions
+    // follow each other in order, and the step in the blend fraction from one
+    // LED to the next, (FRAC_ONE<<FRAC_BITS)/trans_len_, as quotient and
+    // remainder, for render_period
+    int up_end_offset_;
+    int c1_hold_end_offset_;
+    int down_end_offset_;
+    uint32_t t_step_;
+    uint32_t t_step_rem_;
+};
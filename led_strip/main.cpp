@@ -52,7 +52,7 @@ int main()
 
     // EventDispatcher::instance().start_dispatcher();
 
-    MainMenu menu;
+    static MainMenu menu; // the menus and their PIO state are too big for the core 0 stack
     // SingleLEDEventGenerator menu;
     // EventDispatcher::instance().register_event_generator(&menu);
     menu.event_loop();
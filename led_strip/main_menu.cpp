@@ -32,11 +32,13 @@ std::vector<SimpleItemValueMenu::MenuItem> MainMenu::make_menu_items() {
 MainMenu::MainMenu():
     SimpleItemValueMenu(make_menu_items(), std::string("WS2812 pattern generator (Build ")+BuildDate::latest_build_date+")"), 
     pio_(WS2812_DEFAULT_PIN, WS2812_DEFAULT_BAUDRATE),
-    mono_color_menu_(pio_, this),
-    bi_color_menu_(pio_, this),
-    spider_run_menu_(pio_, this)
+    engine_(pio_),
+    mono_color_menu_(engine_, this),
+    bi_color_menu_(engine_, this),
+    spider_run_menu_(engine_, this)
 {
     timer_interval_us_ = 1000000; // 1Hz
+    engine_.launch();
     add_saved_state_supplier(this);
     add_saved_state_supplier(&pio_);
     add_saved_state_supplier(&mono_color_menu_);
@@ -54,7 +56,7 @@ MainMenu::~MainMenu()
 bool MainMenu::event_loop_starting(int& return_code)
 {
     pio_.activate_program();
-    pio_.put_pixel(0, pio_.nled());
+    pio_.put_pixel_run_dma(0, pio_.nled());
     pio_.flush();
     pio_.deactivate_program();
     if(selected_menu_ != 0) {
@@ -129,7 +131,7 @@ bool MainMenu::process_key_press(int key, int key_count, int& return_code,
 
     case 23:
         {
-            save_state();
+            save_state(true);
             PopupMenu pm("State written to flash", 2, true, this, "Information");
             pm.event_loop();
             this->redraw();
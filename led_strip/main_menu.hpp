@@ -5,6 +5,7 @@
 #include "../common/menu.hpp"
 #include "../common/color_led.hpp"
 #include "../common/saved_state.hpp"
+#include "../common/output_engine.hpp"
 
 #include "mono_color_menu.hpp"
 #include "bi_color_menu.hpp"
@@ -49,6 +50,7 @@ private:
     static std::vector<MenuItem> make_menu_items();
 
     SerialPIOMenu pio_;
+    OutputEngine engine_;
     MonoColorMenu mono_color_menu_;
     BiColorMenu bi_color_menu_;
     SpiderRunMenu spider_run_menu_;
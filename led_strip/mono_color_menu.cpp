@@ -16,28 +16,35 @@ namespace {
     static BuildDate build_date(__DATE__,__TIME__);
 }
 
-MonoColorMenu::MonoColorMenu(SerialPIO& pio, SavedStateManager* saved_state_manager):
+MonoColorMenu::MonoColorMenu(OutputEngine& engine, SavedStateManager* saved_state_manager):
     SimpleItemValueMenu(make_menu_items(), "Mono color menu"),
-    pio_(pio), saved_state_manager_(saved_state_manager),
+    engine_(engine), saved_state_manager_(saved_state_manager),
     c_(*this, MIP_R, MIP_G, MIP_B, MIP_H, MIP_S, MIP_V)
 {
     timer_interval_us_ = 1000000; // 1Hz
     c_.redraw(false);
 }
 
-void MonoColorMenu::send_color_string()
+void MonoColorMenu::publish_params()
 {
-    // puts("Sending color string .....");
-    uint32_t color_code = rgb_to_grbz(c_.r(), c_.g(), c_.b());
-    if(pio_.back()) {
-        pio_.put_pixel(0, pio_.nled()-pio_.non());
-        pio_.put_pixel(color_code, pio_.non());
+    Params params;
+    params.color_code = rgb_to_grbz(c_.r(), c_.g(), c_.b());
+    params_.publish(params);
+}
+
+void MonoColorMenu::generate_frame(SerialPIO& pio, uint32_t tick)
+{
+    if(not params_.fetch(render_params_) and tick != 0) {
+        return;
+    }
+    uint32_t color_code = render_params_.color_code;
+    unsigned non = pio.non();
+    unsigned noff = pio.nled()-pio.non();
+    if(pio.back()) {
+        pio.put_pixel_spans_dma({ { 0, noff }, { color_code, non } });
     } else {
-        pio_.put_pixel(color_code, pio_.non());
-        pio_.put_pixel(0, pio_.nled()-pio_.non());
+        pio.put_pixel_spans_dma({ { color_code, non }, { 0, noff } });
     }
-    pio_.flush();
-    // puts("..... color string sent");
 }
 
 std::vector<SimpleItemValueMenu::MenuItem> MonoColorMenu::make_menu_items() 
@@ -57,16 +64,14 @@ std::vector<SimpleItemValueMenu::MenuItem> MonoColorMenu::make_menu_items()
 
 bool MonoColorMenu::event_loop_starting(int& return_code)
 {
-    pio_.activate_program();
-    send_color_string();
+    publish_params();
+    engine_.start(this, FRAME_INTERVAL_US);
     return true;
 }
 
 void MonoColorMenu::event_loop_finishing(int& return_code)
 {
-    pio_.put_pixel(0, pio_.nled());
-    pio_.flush();
-    pio_.deactivate_program();
+    engine_.stop();
 }
 
 bool MonoColorMenu::process_key_press(int key, int key_count, int& return_code,
@@ -76,7 +81,7 @@ bool MonoColorMenu::process_key_press(int key, int key_count, int& return_code,
     bool changed = false;
     if(c_.process_key_press(key, key_count, changed)) {
         if(changed) {
-            send_color_string();
+            publish_params();
         }
         return true;
     }
@@ -85,11 +90,11 @@ bool MonoColorMenu::process_key_press(int key, int key_count, int& return_code,
     case 'z':
     case 'Z':
         c_.set_rgb(0, 0, 0);
-        send_color_string();
+        publish_params();
         break;
     case 'W':
         c_.set_rgb(255, 255, 255);
-        send_color_string();
+        publish_params();
         break;    
 
     case 'q':
@@ -99,7 +104,7 @@ bool MonoColorMenu::process_key_press(int key, int key_count, int& return_code,
 
     case 23:
         if(saved_state_manager_) {
-            saved_state_manager_->save_state();
+            saved_state_manager_->save_state(true);
             PopupMenu pm("State written to flash", 2, true, this, "Information");
             pm.event_loop();
             this->redraw();
@@ -7,10 +7,12 @@
 #include "../common/menu.hpp"
 #include "../common/color_led.hpp"
 #include "../common/saved_state.hpp"
+#include "../common/output_engine.hpp"
 
-class MonoColorMenu: public SimpleItemValueMenu, public SavedStateSupplierConsumer {
+class MonoColorMenu: public SimpleItemValueMenu, public SavedStateSupplierConsumer,
+                     public FrameGenerator {
 public:
-    MonoColorMenu(SerialPIO& pio_, SavedStateManager* saved_state_manager = nullptr);
+    MonoColorMenu(OutputEngine& engine, SavedStateManager* saved_state_manager = nullptr);
     virtual ~MonoColorMenu() { }
     bool event_loop_starting(int& return_code) final;
     void event_loop_finishing(int& return_code) final;
@@ -23,6 +25,8 @@ public:
     int32_t get_version() override;
     int32_t get_supplier_id() override;
 
+    void generate_frame(SerialPIO& pio, uint32_t tick) override;
+
 private:
     enum MenuItemPositions {
         MIP_R,
@@ -40,10 +44,20 @@ private:
 
     std::vector<MenuItem> make_menu_items();
 
-    void send_color_string();
+    void publish_params();
+
+    // The color is only sent when it changes, the frame interval just sets
+    // how quickly that is picked up
+    static constexpr uint32_t FRAME_INTERVAL_US = 20000; // 50Hz
 
-    SerialPIO& pio_;
+    OutputEngine& engine_;
     SavedStateManager* saved_state_manager_ = nullptr;
 
     RGBHSVMenuItems c_;
+
+    struct Params {
+        uint32_t color_code;
+    };
+    SharedParams<Params> params_;
+    Params render_params_ = { };
 };
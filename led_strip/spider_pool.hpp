@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+
+// Live spiders of the spider run menu, in no order, with each of their
+// fields in its own array so the frame loop reads them in sequence. A spider
+// is added at the end and removed by moving the last one into its place, so
+// neither touches the heap. A spider takes 8 bytes : the position it is
+// stepping to and the one it is leaving (the same between steps), where it
+// is going, the frames between half steps and those left to the next.
+template<int CAPACITY> struct SpiderPool {
+    static constexpr int capacity = CAPACITY;
+
+    int nspider = 0;
+    int16_t x0[CAPACITY];
+    int16_t x1[CAPACITY];
+    int16_t xdest[CAPACITY];
+    uint8_t tupdate[CAPACITY];
+    uint8_t tnext[CAPACITY];
+
+    void add(int x, int xd, unsigned tu) {
+        x0[nspider] = x1[nspider] = x;
+        xdest[nspider] = xd;
+        tupdate[nspider] = tnext[nspider] = tu;
+        ++nspider;
+    }
+
+    void remove(int ispider) {
+        --nspider;
+        x0[ispider] = x0[nspider];
+        x1[ispider] = x1[nspider];
+        xdest[ispider] = xdest[nspider];
+        tupdate[ispider] = tupdate[nspider];
+        tnext[ispider] = tnext[nspider];
+    }
+
+    // Move each spider that is due by a half step, removing those that have
+    // reached their destination
+    void move() {
+        for(int is=0; is<nspider;) {
+            if(--tnext[is] == 0) {
+                tnext[is] = tupdate[is];
+                if(x0[is] != x1[is]) {
+                    // Finish half-step
+                    x1[is] = x0[is];
+                } else if(x0[is] > xdest[is]) {
+                    // Start half-step to "left"
+                    x0[is] -= 1;
+                } else if(x0[is] < xdest[is]) {
+                    // Start half-step to "right"
+                    x0[is] += 1;
+                } else {
+                    // Reached destination - the last spider takes its place,
+                    // and is looked at next
+                    remove(is);
+                    continue;
+                }
+            }
+            is++;
+        }
+    }
+
+    // Start new spiders on random LEDs of the nled, going to random LEDs,
+    // each with probability spawn_rate/4096 after the one before, while
+    // there are fewer than max_spiders
+    template<typename Rng> void spawn(Rng& rng, int nled, int spawn_rate,
+        int min_tupdate, int max_tupdate, int max_spiders)
+    {
+        unsigned ix = rng();
+        while((ix&0xFFF) < unsigned(spawn_rate) and nspider < max_spiders) {
+            int x = rng() % nled;
+            int xd = rng() % nled;
+            unsigned tu = min_tupdate;
+            if(max_tupdate > min_tupdate) {
+                tu += rng() % (max_tupdate - min_tupdate + 1);
+            }
+            add(x, xd, tu);
+            ix = rng();
+        }
+    }
+};
@@ -17,9 +17,9 @@ namespace {
     static BuildDate build_date(__DATE__,__TIME__);
 }
 
-SpiderRunMenu::SpiderRunMenu(SerialPIO& pio, SavedStateManager* saved_state_manager):
+SpiderRunMenu::SpiderRunMenu(OutputEngine& engine, SavedStateManager* saved_state_manager):
     SimpleItemValueMenu(make_menu_items(), "Spider run menu"),
-    pio_(pio), saved_state_manager_(saved_state_manager),
+    engine_(engine), saved_state_manager_(saved_state_manager),
     c_(*this, MIP_R, MIP_G, MIP_B, MIP_H, MIP_S, MIP_V),
     rng_(12939) // Essential supply
 {
@@ -27,27 +27,37 @@ SpiderRunMenu::SpiderRunMenu(SerialPIO& pio, SavedStateManager* saved_state_mana
     c_.redraw(false);
 }
 
-void SpiderRunMenu::send_color_string()
+void SpiderRunMenu::publish_params()
+{
+    Params params;
+    params.color_code = rgb_to_grbz(c_.r(), c_.g(), c_.b());
+    params.spawn_rate = spawn_rate_;
+    params.max_tupdate = max_tupdate_;
+    params.min_tupdate = min_tupdate_;
+    params.collision = collision_;
+    params.max_spiders = max_spiders_;
+    params_.publish(params);
+}
+
+void SpiderRunMenu::send_color_string(SerialPIO& pio)
 {
     // puts("Sending color string .....");
-    uint32_t cc = rgb_to_grbz(c_.r(), c_.g(), c_.b());
-    for(int i=0;i<pio_.non(); ++i) {
-        color_codes_[i] = cc;
+
+    // Render into the back buffer while the previous frame is transmitted
+    uint32_t* color_codes = pio.back_buffer().data();
+
+    uint32_t cc = render_params_.color_code;
+    for(int i=0;i<pio.non(); ++i) {
+        color_codes[i] = cc;
     }
     cc = 0;
-    for(const auto& s : spiders_) {
-        color_codes_[s.x0] = cc;
-        color_codes_[s.x1] = cc;
+    const auto& sp = spiders_;
+    for(int is=0; is<sp.nspider; ++is) {
+        color_codes[sp.x0[is]] = cc;
+        color_codes[sp.x1[is]] = cc;
     }
 
-    if(pio_.back()) {
-        pio_.put_pixel(0, pio_.nled()-pio_.non());
-        pio_.put_pixel_vector(color_codes_);
-    } else {
-        pio_.put_pixel_vector(color_codes_);
-        pio_.put_pixel(0, pio_.nled()-pio_.non());
-    }
-    pio_.flush();
+    pio.send_frame();
     // puts("..... color string sent");
 }
 
@@ -61,6 +71,7 @@ std::vector<SimpleItemValueMenu::MenuItem> SpiderRunMenu::make_menu_items()
     menu_items.at(MIP_MAX_TUPDATE)  = {"[/]     : Decrease/Increase maximum spider speed (min..127)", 3, "10"};
     menu_items.at(MIP_MIN_TUPDATE)  = {"{/}     : Decrease/Increase minimum spider speed (1..max)", 3, "10"};
     menu_items.at(MIP_COLLISION)   = {"c       : Enable collision detection", 4, "OFF"};
+    menu_items.at(MIP_MAX_SPIDERS) = {"m       : Set maximum number of spiders (0..1024)", 4, std::to_string(MAX_SPIDERS)};
 
     menu_items.at(MIP_WRITE_STATE) = {"Ctrl-w  : Write state to flash", 0, ""};
     menu_items.at(MIP_EXIT)        = {"q       : Exit menu", 0, ""};
@@ -92,19 +103,22 @@ void SpiderRunMenu::set_collision_value(bool draw)
     if(draw)draw_item_value(MIP_COLLISION);
 }
 
+void SpiderRunMenu::set_max_spiders_value(bool draw)
+{
+    menu_items_[MIP_MAX_SPIDERS].value = std::to_string(max_spiders_);
+    if(draw)draw_item_value(MIP_MAX_SPIDERS);
+}
+
 bool SpiderRunMenu::event_loop_starting(int& return_code)
 {
-    color_codes_.resize(pio_.non());
-    pio_.activate_program();
-    send_color_string();
+    publish_params();
+    engine_.start(this, FRAME_INTERVAL_US);
     return true;
 }
 
 void SpiderRunMenu::event_loop_finishing(int& return_code)
 {
-    pio_.put_pixel(0, pio_.nled());
-    pio_.flush();
-    pio_.deactivate_program();
+    engine_.stop();
 }
 
 bool SpiderRunMenu::process_key_press(int key, int key_count, int& return_code,
@@ -114,7 +128,7 @@ bool SpiderRunMenu::process_key_press(int key, int key_count, int& return_code,
     bool changed = false;
     if(c_.process_key_press(key, key_count, changed)) {
         if(changed) {
-            send_color_string();
+            publish_params();
         }
         return true;
     }
@@ -124,15 +138,18 @@ bool SpiderRunMenu::process_key_press(int key, int key_count, int& return_code,
         if(increase_value_in_range(spawn_rate_, 255, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_spawn_rate_value();
         }
+        publish_params();
         break;
     case '<':
         if(decrease_value_in_range(spawn_rate_, 0, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_spawn_rate_value();
         }
+        publish_params();
         break;
     case '^':
         InplaceInputMenu::input_value_in_range(spawn_rate_, 0, 255, this, MIP_SPAWN_RATE, 3);
         set_spawn_rate_value();
+        publish_params();
         break;
 
     case '}':
@@ -143,17 +160,20 @@ bool SpiderRunMenu::process_key_press(int key, int key_count, int& return_code,
                 set_max_tupdate_value();
             }
         }
+        publish_params();
         break;
     case '{':
         if(decrease_value_in_range(min_tupdate_, 1, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_min_tupdate_value();
         }
+        publish_params();
         break;
 
     case ']':
         if(increase_value_in_range(max_tupdate_, 127, (key_count >= 15 ? 5 : 1), key_count==1)) {
             set_max_tupdate_value();
         }
+        publish_params();
         break;
     case '[':
         if(decrease_value_in_range(max_tupdate_, 1, (key_count >= 15 ? 5 : 1), key_count==1)) {
@@ -163,6 +183,14 @@ bool SpiderRunMenu::process_key_press(int key, int key_count, int& return_code,
                 set_min_tupdate_value();
             }
         }
+        publish_params();
+        break;
+
+    case 'm':
+    case 'M':
+        InplaceInputMenu::input_value_in_range(max_spiders_, 0, MAX_SPIDERS, this, MIP_MAX_SPIDERS, 4);
+        set_max_spiders_value();
+        publish_params();
         break;
 
     case 'q':
@@ -172,7 +200,7 @@ bool SpiderRunMenu::process_key_press(int key, int key_count, int& return_code,
 
     case 23:
         if(saved_state_manager_) {
-            saved_state_manager_->save_state();
+            saved_state_manager_->save_state(true);
             PopupMenu pm("State written to flash", 2, true, this, "Information");
             pm.event_loop();
             this->redraw();
@@ -180,11 +208,7 @@ bool SpiderRunMenu::process_key_press(int key, int key_count, int& return_code,
         break;
 
     case 'D':
-        printf("t = %d\n", t_);
-        printf("nspider = %d\n", spiders_.size());
-        for(const auto& s : spiders_) {
-            printf("- x0 = %d  x1 = %d  xdest = %d  tupdate = %d  age = %d\n", s.x0, s.x1, s.xdest, s.tupdate, t_-s.t0);
-        }
+        engine_.send_command(CMD_DEBUG_DUMP);
         break;
 
     default:
@@ -206,46 +230,51 @@ bool SpiderRunMenu::process_timer(bool controller_is_connected, int& return_code
         }
         heartbeat_timer_count_ = 0;
     }
+    return true;
+}
 
-    for(auto is = spiders_.begin(); is != spiders_.end();) {
-        if((t_ - is->t0) % is->tupdate == 0) {
-            if(is->x0 != is->x1) {
-                // Finish half-step
-                is->x1 = is->x0;
-            } else if(is->x0 > is->xdest) {
-                // Start half-step to "left"
-                is->x0 -= 1;
-            } else if(is->x0 < is->xdest) {
-                // Start half-step to "right"
-                is->x0 += 1;
-            } else {
-                // Reached destination - erase spider and advance iterator
-                is = spiders_.erase(is);
-                continue;
-            }
-        }
-        is++;
-    } 
-
-    unsigned ix = rng_();
-    while((ix&0xFFF) < unsigned(spawn_rate_) and spiders_.size() < (unsigned)pio_.non()/2) {
-        Spider s;
-        s.x0 = s.x1 = rng_() % pio_.non();
-        s.xdest = rng_() % pio_.non();
-        s.tupdate = min_tupdate_;
-        if(max_tupdate_ > min_tupdate_) {
-            s.tupdate += rng_() % (max_tupdate_ - min_tupdate_ + 1);
-        }
-        s.t0 = t_;
-        spiders_.push_back(s);
-        ix = rng_();
+void SpiderRunMenu::print_spiders()
+{
+    printf("t = %d\n", t_);
+    const auto& sp = spiders_;
+    printf("nspider = %d\n", sp.nspider);
+    for(int is=0; is<sp.nspider; ++is) {
+        printf("- x0 = %d  x1 = %d  xdest = %d  tupdate = %d  tnext = %d\n",
+            sp.x0[is], sp.x1[is], sp.xdest[is], sp.tupdate[is], sp.tnext[is]);
     }
+}
 
-    send_color_string();
+void SpiderRunMenu::move_spiders(SerialPIO& pio)
+{
+    const Params& p = render_params_;
+    spiders_.move();
+    spiders_.spawn(rng_, pio.non(), p.spawn_rate, p.min_tupdate, p.max_tupdate,
+        std::min(p.max_spiders, pio.non()/2));
+}
 
-    t_++;
+void SpiderRunMenu::process_command(SerialPIO& pio, int command)
+{
+    switch(command) {
+    case CMD_DEBUG_DUMP:
+        // Printed from here since the spiders belong to core 1, this delays
+        // the frame, but only when asked for
+        print_spiders();
+        printf("frames = %lu  missed = %lu  max_late_us = %lu\n",
+            (unsigned long)engine_.frame_count(), (unsigned long)engine_.missed_frame_count(),
+            (unsigned long)engine_.max_late_us());
+        break;
+    }
+}
 
-    return true;
+void SpiderRunMenu::generate_frame(SerialPIO& pio, uint32_t tick)
+{
+    params_.fetch(render_params_);
+    // The first frame shows the spiders as they were left
+    if(tick != 0) {
+        move_spiders(pio);
+    }
+    send_color_string(pio);
+    t_++;
 }
 
 std::vector<int32_t> SpiderRunMenu::get_saved_state()
@@ -258,12 +287,13 @@ std::vector<int32_t> SpiderRunMenu::get_saved_state()
     state.push_back(max_tupdate_);
     state.push_back(min_tupdate_);
     state.push_back(collision_);
+    state.push_back(max_spiders_);
     return state;
 }
 
 bool SpiderRunMenu::set_saved_state(const std::vector<int32_t>& state)
 {
-    if(state.size() != 7) {
+    if(state.size() != 8) {
         return false;
     }
     c_.set_rgb(state[0], state[1], state[2], false);
@@ -271,16 +301,18 @@ bool SpiderRunMenu::set_saved_state(const std::vector<int32_t>& state)
     max_tupdate_ = state[4];
     min_tupdate_ = state[5];
     collision_ = state[6];
+    max_spiders_ = std::min(std::max(int(state[7]), 0), MAX_SPIDERS);
     set_spawn_rate_value(false);
     set_max_tupdate_value(false);
     set_min_tupdate_value(false);
     set_collision_value(false);
+    set_max_spiders_value(false);
     return true;
 }
 
 int32_t SpiderRunMenu::get_version()
 {
-    return 0;
+    return 1;
 }
 
 int32_t SpiderRunMenu::get_supplier_id()
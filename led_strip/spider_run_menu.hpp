@@ -1,17 +1,21 @@
 #pragma once
 
 #include <vector>
-#include <list>
+#include <cstdint>
 
 #include <pico/stdlib.h>
 
 #include "../common/menu.hpp"
 #include "../common/color_led.hpp"
 #include "../common/saved_state.hpp"
+#include "../common/output_engine.hpp"
 
-class SpiderRunMenu: public SimpleItemValueMenu, public SavedStateSupplierConsumer {
+#include "spider_pool.hpp"
+
+class SpiderRunMenu: public SimpleItemValueMenu, public SavedStateSupplierConsumer,
+                     public FrameGenerator {
 public:
-    SpiderRunMenu(SerialPIO& pio_, SavedStateManager* saved_state_manager = nullptr);
+    SpiderRunMenu(OutputEngine& engine, SavedStateManager* saved_state_manager = nullptr);
     virtual ~SpiderRunMenu() { }
     bool event_loop_starting(int& return_code) final;
     void event_loop_finishing(int& return_code) final;
@@ -24,7 +28,15 @@ public:
     int32_t get_version() override;
     int32_t get_supplier_id() override;
 
+    void process_command(SerialPIO& pio, int command) override;
+    void generate_frame(SerialPIO& pio, uint32_t tick) override;
+
 private:
+    // Commands sent to the generator on core 1
+    enum Command {
+        CMD_DEBUG_DUMP
+    };
+
     enum MenuItemPositions {
         MIP_R,
         MIP_G,
@@ -36,6 +48,7 @@ private:
         MIP_MAX_TUPDATE,
         MIP_MIN_TUPDATE,
         MIP_COLLISION,
+        MIP_MAX_SPIDERS,
         MIP_WRITE_STATE,
         MIP_EXIT,
         MIP_NUM_ITEMS // MUST BE LAST ITEM IN LIST
@@ -47,10 +60,20 @@ private:
     void set_max_tupdate_value(bool draw = true);
     void set_min_tupdate_value(bool draw = true);
     void set_collision_value(bool draw = true);
+    void set_max_spiders_value(bool draw = true);
+
+    void publish_params();
+    void move_spiders(SerialPIO& pio);
+    void send_color_string(SerialPIO& pio);
+    void print_spiders();
 
-    void send_color_string();
+    static constexpr uint32_t FRAME_INTERVAL_US = 20000; // 50Hz
 
-    SerialPIO& pio_;
+    // At most one spider for every two LEDs of the longest chain, which is
+    // reached on long chains with slow spiders (bench_spider_pool), 8 KB
+    static constexpr int MAX_SPIDERS = MAX_PIXELS / 2;
+
+    OutputEngine& engine_;
     SavedStateManager* saved_state_manager_ = nullptr;
 
     RGBHSVMenuItems c_;
@@ -59,19 +82,23 @@ private:
     int max_tupdate_ = 10;
     int min_tupdate_ = 10;
     bool collision_ = false;
+    int max_spiders_ = MAX_SPIDERS;
+
+    int heartbeat_timer_count_ = 0;
 
-    struct Spider {
-        int x0;
-        int x1;
-        int xdest;
-        unsigned tupdate;
-        unsigned t0;
+    struct Params {
+        uint32_t color_code;
+        int spawn_rate;
+        int max_tupdate;
+        int min_tupdate;
+        bool collision;
+        int max_spiders;
     };
+    SharedParams<Params> params_;
 
-    int heartbeat_timer_count_ = 0;
+    // Render state, only touched on core 1
+    Params render_params_ = { };
     unsigned t_ = 0;
-    std::vector<uint32_t> color_codes_;
-    std::list<Spider> spiders_;
-
+    SpiderPool<MAX_SPIDERS> spiders_;
     std::minstd_rand rng_;
 };